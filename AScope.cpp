@@ -22,8 +22,11 @@
 // ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
 // *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
 #include "AScope.h"
+#include "AScopeEngine.h"
 #include "ScopePlot.h"
 #include "Knob.h"
+#include "ImageWriter.h"
+#include "DspKernels.h"
 
 #include <QMessageBox>
 #include <QButtonGroup>
@@ -42,42 +45,110 @@
 #include <QPalette>
 #include <QDateTime>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QDir>
+#include <QPixmap>
 #include <QProgressBar>
 #include <string>
 #include <algorithm>
-#include <unistd.h>
 
 #include <iostream>
 #include <time.h>
 
+namespace {
+	/// @return A monotonic time, in seconds.
+	double now() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + 1.0e-9*ts.tv_nsec;
+	}
+
+	/// @return The time of day, in seconds since the epoch.
+	double wallClock() {
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		return ts.tv_sec + 1.0e-9*ts.tv_nsec;
+	}
+
+	/// Order targets strongest first.
+	bool strongerTarget(const CfarDetection& a, const CfarDetection& b) {
+		return a.snr > b.snr;
+	}
+}
+
 #include <qwt_wheel.h>
 
 //////////////////////////////////////////////////////////////////////
-AScope::AScope(double refreshRateHz, std::string saveDir, QWidget* parent ) :
+AScope::AScope(double refreshRateHz, std::string saveDir, QWidget* parent,
+		AScopeEngine* engine) :
     QWidget(parent),
     _refreshIntervalHz(refreshRateHz),
+    _timerId(0),
+    _timerIntervalMs(0),
+    _awaitingFrame(false),
+    _renderSecs(0.0),
+    _processSecs(0.0),
+    _gateStatsForPlot(false),
+    _latencyShownAt(0.0),
+    _shownSerial(-1),
     _IQplot(TRUE),
-    _fftwData(0),
+    _tsPlotType(TS_IANDQ_PLOT),
+    _doHamming(false),
     _blockSize(64),
+    _zoom(1),
+    _zoomCenterHz(0.0),
+    _spectrumZoom(1),
+    _spectrumCenterHz(0.0),
+    _singleShot(false),
+    _pairChannel(1),
     _paused(false),
     _zeroMoment(0.0),
+    _continuousAutoscale(false),
     _channel(0),
     _gateChoice(0),
     _combosInitialized(false),
     _alongBeam(false),
-    _nextIQ(0),
     _gates(0),
-    _capture(true),
     _saveDir(saveDir),
-    _sampleRateHz(10.0e6)
+    _imagesInFlight(0),
+    _snapshotTimer(0),
+    _sampleRateHz(10.0e6),
+    _ready(false),
+    _engine(engine),
+    _subscriberId(-1),
+    _lastItemCount(0)
 {
     // Set up our form
     setupUi(this);
 
+    // Subscribe to the processing engine, creating our own if
+    // none was provided. Our private engine hands its items
+    // back through our returnTSItem().
+    if (!_engine) {
+        _engine = new AScopeEngine(this);
+        connect(_engine, SIGNAL(returnTSItem(AScope::TimeSeries)),
+                this, SIGNAL(returnTSItem(AScope::TimeSeries)));
+        connect(_engine, SIGNAL(returnTSBatch(AScope::TimeSeriesBatch)),
+                this, SIGNAL(returnTSBatch(AScope::TimeSeriesBatch)));
+    }
+    _subscriberId = _engine->subscribe(AScopeEngine::Selection());
+    connect(_engine, SIGNAL(frameReady(int, ScopeFramePtr)),
+            this, SLOT(frameSlot(int, ScopeFramePtr)));
+    connect(_engine, SIGNAL(gatesChanged(int)),
+            this, SLOT(gatesChangedSlot(int)));
+    connect(_engine, SIGNAL(gateWindowChanged(GateWindow)),
+            this, SLOT(gateWindowChangedSlot(GateWindow)));
+    if (_engine->isReady()) {
+        _ready = true;
+    } else {
+        connect(_engine, SIGNAL(ready()), this, SLOT(fftPreparedSlot()));
+    }
+
     // Let's be reasonable with the refresh rate.
     if (refreshRateHz < 1.0) {
     	refreshRateHz = 1.0;
     }
+    _refreshIntervalHz = refreshRateHz;
 
     // initialize running statistics
     for (int i = 0; i < 3; i++) {
@@ -90,6 +161,11 @@ AScope::AScope(double refreshRateHz, std::string saveDir, QWidget* parent ) :
 	// create a button group for the channels
 	_chanButtonGroup = new QButtonGroup;
 
+	// Images are encoded and written one at a time, in the background.
+	_imagePool.setMaxThreadCount(1);
+	_snapshotTimer = new QTimer(this);
+	connect(_snapshotTimer, SIGNAL(timeout()), this, SLOT(autoSnapshotSlot()));
+
     // connect the controls
     connect(_autoScale,       SIGNAL(released()),           this, SLOT(autoScaleSlot()));
     connect(_gainKnob,        SIGNAL(valueChanged(double)), this, SLOT(gainChangeSlot(double)));
@@ -97,11 +173,24 @@ AScope::AScope(double refreshRateHz, std::string saveDir, QWidget* parent ) :
     connect(_dn,              SIGNAL(released()),           this, SLOT(dnSlot()));
     connect(_saveImage,       SIGNAL(released()),           this, SLOT(saveImageSlot()));
     connect(_pauseButton,     SIGNAL(toggled(bool)),        this, SLOT(pauseSlot(bool)));
+    connect(_historySlider,   SIGNAL(valueChanged(int)),    this, SLOT(historySlot(int)));
     connect(_windowButton,    SIGNAL(toggled(bool)),        this, SLOT(windowSlot(bool)));
     connect(_gateNumber,      SIGNAL(activated(int)),       this, SLOT(gateChoiceSlot(int)));
     connect(_alongBeamCheck,  SIGNAL(toggled(bool)),        this, SLOT(alongBeamSlot(bool)));
     connect(_blockSizeCombo,  SIGNAL(activated(int)),       this, SLOT(blockSizeSlot(int)));
     connect(_chanButtonGroup, SIGNAL(buttonReleased(int)),  this, SLOT(channelSlot(int)));
+    connect(_zoomCombo,       SIGNAL(activated(int)),       this, SLOT(zoomSlot(int)));
+    connect(_zoomCenter,      SIGNAL(valueChanged(double)), this, SLOT(zoomCenterSlot(double)));
+    connect(_filterCombo,     SIGNAL(activated(int)),       this, SLOT(filterSlot(int)));
+    connect(_triggerCombo,    SIGNAL(activated(int)),       this, SLOT(triggerModeSlot(int)));
+    connect(_triggerLevel,    SIGNAL(valueChanged(double)), this, SLOT(triggerLevelSlot(double)));
+    connect(_preTrigger,      SIGNAL(valueChanged(int)),    this, SLOT(preTriggerSlot(int)));
+    connect(_singleShotCheck, SIGNAL(toggled(bool)),        this, SLOT(singleShotSlot(bool)));
+    connect(_pairChannelBox,  SIGNAL(valueChanged(int)),    this, SLOT(pairChannelSlot(int)));
+    connect(_cfarCombo,       SIGNAL(activated(int)),       this, SLOT(cfarModeSlot(int)));
+    connect(_gateStart,       SIGNAL(valueChanged(int)),    this, SLOT(gateWindowSlot()));
+    connect(_gateStop,        SIGNAL(valueChanged(int)),    this, SLOT(gateWindowSlot()));
+    connect(_gateStride,      SIGNAL(valueChanged(int)),    this, SLOT(gateWindowSlot()));
 
     connect(_xGrid, SIGNAL(toggled(bool)), _scopePlot, SLOT(enableXgrid(bool)));
     connect(_yGrid, SIGNAL(toggled(bool)), _scopePlot, SLOT(enableYgrid(bool)));
@@ -111,6 +200,11 @@ AScope::AScope(double refreshRateHz, std::string saveDir, QWidget* parent ) :
     _xGrid->setChecked(true);
     _yGrid->setChecked(true);
 
+    // The range-time display shares the plot area with the scope plot.
+    _rtiPlot = new RtiPlot(this);
+    horizontalLayout_2->insertWidget(1, _rtiPlot);
+    _rtiPlot->hide();
+
     // initialize the book keeping for the plots.
     // This also sets up the radio buttons
     // in the plot type tab widget
@@ -123,6 +217,10 @@ AScope::AScope(double refreshRateHz, std::string saveDir, QWidget* parent ) :
     _gainKnob->setScaleMaxMajor(5);
     _gainKnob->setScaleMaxMinor(5);
 
+    // Initialize the block size and channel choices. The fft plans
+    // and window tables are built in the background by the engine.
+    initCombos(4);
+
     // initialize the activity bar
     _activityBar->setRange(0, 100);
     _activityBar->setValue(0);
@@ -143,43 +241,140 @@ AScope::AScope(double refreshRateHz, std::string saveDir, QWidget* parent ) :
     // The initial plot type will be I and Q timeseries
     plotTypeSlot(TS_IANDQ_PLOT);
 
-
-    // start the statistics timer
-    int interval = (int)(1000/_refreshIntervalHz);
-    if (interval < 1) {
-    	// require at least 1 ms pauses.
-    	interval = 1;
+    // A shared engine may already be receiving data, with a window
+    // of gates set, in which case gatesChanged() and
+    // gateWindowChanged() will not come until they change.
+    gateWindowChangedSlot(_engine->gateWindow());
+    int gates = _engine->gates();
+    if (gates > 0) {
+        gatesChangedSlot(gates);
     }
-    startTimer(interval);
-
-    // let the data sources get themselves ready
-    sleep(1);
 
+    // start the frame request timer, at the highest rate
+    // until the cost of a frame is known
+    adaptRefresh();
 }
 //////////////////////////////////////////////////////////////////////
 AScope::~AScope() {
+	_engine->unsubscribe(_subscriberId);
+	if (_gateStatsForPlot) {
+		_engine->setGateStatsEnabled(false);
+	}
+
+	// let pending image writes finish
+	_imagePool.waitForDone();
 }
 
 //////////////////////////////////////////////////////////////////////
-void AScope::initCombos(int channels, int gates) {
+void AScope::initCombos(int channels) {
 
-	// initialize the fft numerics
+	// initialize the block sizes
 	initBlockSizes();
 
-	// initialize the number of gates.
-	initGates(gates);
+	// initialize the spectrum zoom
+	initZoom();
+
+	// initialize the pre-filters
+	initFilters();
+
+	// initialize the trigger
+	initTrigger();
+
+	// initialize the target detection
+	initCfar();
 
 	// initialize the channels
 	initChans(channels);
 }
 
+//////////////////////////////////////////////////////////////////////
+void AScope::initZoom() {
+	// zoom factors are powers of two
+	for (int z = 1; z <= 32; z = z*2) {
+		QString l = (z == 1) ? QString("Off") : QString("%1x").arg(z);
+		_zoomCombo->addItem(l, QVariant(z));
+	}
+	_zoomCombo->setCurrentIndex(0);
+	// the center can be anywhere in the band
+	_zoomCenter->setRange(-_sampleRateHz/2.0, _sampleRateHz/2.0);
+	_zoomCenter->setValue(0.0);
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::initFilters() {
+	PreFilterSpec spec;
+	_filterChoices.push_back(spec);
+	_filterCombo->addItem("None");
+
+	spec.removeMean = true;
+	_filterChoices.push_back(spec);
+	_filterCombo->addItem("Mean removal");
+
+	spec = PreFilterSpec();
+	spec.regressionOrder = 2;
+	_filterChoices.push_back(spec);
+	_filterCombo->addItem("Regression, order 2");
+
+	spec.regressionOrder = 4;
+	_filterChoices.push_back(spec);
+	_filterCombo->addItem("Regression, order 4");
+
+	spec = PreFilterSpec();
+	spec.notch = true;
+	_filterChoices.push_back(spec);
+	_filterCombo->addItem("DC notch");
+
+	_filterCombo->setCurrentIndex(0);
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::initTrigger() {
+	// the item data is the TriggerSpec::Mode
+	_triggerCombo->addItem("Off",          QVariant(int(TriggerSpec::OFF)));
+	_triggerCombo->addItem("Level",        QVariant(int(TriggerSpec::LEVEL)));
+	_triggerCombo->addItem("Rising Edge",  QVariant(int(TriggerSpec::RISING_EDGE)));
+	_triggerCombo->addItem("Falling Edge", QVariant(int(TriggerSpec::FALLING_EDGE)));
+	_triggerCombo->addItem("Power",        QVariant(int(TriggerSpec::POWER)));
+	_triggerCombo->setCurrentIndex(0);
+	_triggerLevel->setValue(_trigger.level);
+	_preTrigger->setValue(_trigger.preSamples);
+	_singleShotCheck->setChecked(_singleShot);
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::initCfar() {
+	// the item data is the CfarSpec::Mode
+	_cfarCombo->addItem("Cell Averaging",    QVariant(int(CfarSpec::CELL_AVERAGING)));
+	_cfarCombo->addItem("Ordered Statistic", QVariant(int(CfarSpec::ORDERED_STATISTIC)));
+	_cfarCombo->setCurrentIndex(0);
+	_cfar.mode = CfarSpec::CELL_AVERAGING;
+}
+
 //////////////////////////////////////////////////////////////////////
 void AScope::initGates(int gates) {
-	// populate the gate selection combo box
-	for (int g = 0; g < gates; g++) {
+	// populate the gate selection combo box with the gates
+	// in the window; the item data is the gate number
+	_gateNumber->clear();
+	int count = _gateWindow.count(gates);
+	for (int i = 0; i < count; i++) {
+		int g = _gateWindow.gate(i);
         QString l = QString("%1").arg(g);
 		_gateNumber->addItem(l, QVariant(g));
 	}
+
+	// keep the selected gate if it is in the window,
+	// otherwise take the nearest one that is
+	int index = _gateWindow.index(_gateChoice, gates);
+	if (index >= count) {
+		index = count - 1;
+	}
+	if (index >= 0) {
+		_gateNumber->setCurrentIndex(index);
+		if (_gateWindow.gate(index) != _gateChoice) {
+			_gateChoice = _gateWindow.gate(index);
+			updateSelection();
+		}
+	}
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -206,87 +401,265 @@ void AScope::initChans(int channels) {
 			r->setChecked(false);
 		}
 	}
+
+	// the second channel for the dual channel plots
+	_pairChannelBox->setRange(0, channels - 1);
+	_pairChannelBox->setValue(_pairChannel);
 }
 //////////////////////////////////////////////////////////////////////
 void AScope::initBlockSizes() {
 
     // configure the block/fft size selection
-    /// @todo add logic to insure that smallest fft size is a power of two.
-    int fftSize = 8;
-    int maxFftSize = 4096;
-    for (; fftSize <= maxFftSize; fftSize = fftSize*2) {
-        _blockSizeChoices.push_back(fftSize);
-        QString l = QString("%1").arg(fftSize);
-        _blockSizeCombo->addItem(l, QVariant(fftSize));
+    int initialIndex = 5;
+    _blockSizeChoices = AScopeEngine::blockSizeChoices();
+    for (unsigned int i = 0; i < _blockSizeChoices.size(); i++) {
+        QString l = QString("%1").arg(_blockSizeChoices[i]);
+        _blockSizeCombo->addItem(l, QVariant(_blockSizeChoices[i]));
     }
 
     // initialize items that depend on the block size selection
-    // (fftw and hamming coefficients)
-    _blockSizeCombo->setCurrentIndex(5);
-    blockSizeSlot(5);
+    _blockSizeCombo->setCurrentIndex(initialIndex);
+    blockSizeSlot(initialIndex);
 
 }
 
 //////////////////////////////////////////////////////////////////////
-void AScope::initFFT(int size) {
+void AScope::fftPreparedSlot() {
+    _ready = true;
+    emit scopeReady();
+}
 
-	// return existing structures, if we have them
-	if (_fftwData) {
-		fftw_destroy_plan(_fftwPlan);
-		fftw_free(_fftwData);
-	}
+//////////////////////////////////////////////////////////////////////
+bool AScope::isReady() const {
+    return _ready;
+}
 
-	// allocate space
-	_fftwData = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)* size);
+//////////////////////////////////////////////////////////////////////
+AScopeEngine* AScope::engine() {
+    return _engine;
+}
 
-	// create the plan.
-	_fftwPlan = fftw_plan_dft_1d(size, _fftwData, _fftwData,
-			FFTW_FORWARD,
-			FFTW_ESTIMATE);
+//////////////////////////////////////////////////////////////////////
+void AScope::updateSelection() {
+    AScopeEngine::Selection sel;
+    sel.channel = _channel;
+    sel.gate = _gateChoice;
+    sel.alongBeam = _alongBeam;
+    sel.blockSize = _blockSize;
+    sel.window = _doHamming;
+    sel.spectrum = (_tsPlotType == TS_SPECTRUM_PLOT);
+    // zooming only matters to the spectrum; don't make the
+    // engine gather the longer time series otherwise.
+    sel.zoom = sel.spectrum ? _zoom : 1;
+    sel.zoomCenterHz = _zoomCenterHz;
+    sel.preFilter = _preFilter;
+    sel.trigger = _trigger;
+    // the range-time display wants every beam's power profile
+    if (_tsPlotType == TS_RTI_PLOT) {
+        sel.alongBeam = true;
+        sel.profiles = true;
+    }
+    // the gate statistics come from the engine; a beam
+    // frame paces the display
+    if (_tsPlotType == TS_GATE_STATS_PLOT) {
+        sel.alongBeam = true;
+    }
+    // the detection runs on the beam's power profile
+    if (_tsPlotType == TS_CFAR_PLOT) {
+        sel.alongBeam = true;
+        sel.cfar = _cfar;
+    }
+    // the dual channel plots want the products with the second channel
+    if (_crossPlots.find(_tsPlotType) != _crossPlots.end()) {
+        sel.pairChannel = _pairChannel;
+    }
 
-	hammingSetup(size);
+    _engine->setSelection(_subscriberId, sel);
 }
 
-
 //////////////////////////////////////////////////////////////////////
 void AScope::saveImageSlot() {
     QString f = _saveDir.c_str();
 
-    QFileDialog d( this, tr("Save AScope Image"), f,
+    QFileDialog* d = new QFileDialog( this, tr("Save AScope Image"), f,
             tr("PNG files (*.png);;All files (*.*)"));
-    d.setFileMode(QFileDialog::AnyFile);
-    d.setViewMode(QFileDialog::Detail);
-    d.setAcceptMode(QFileDialog::AcceptSave);
-    d.setConfirmOverwrite(true);
-    d.setDefaultSuffix("png");
-    d.setDirectory(f);
+    // Capture the display now, so that what is saved is what the
+    // user saw when the button was pressed. Each dialog carries its
+    // own image, since several may be open at once.
+    d->setProperty("image", grabImage());
+    d->setAttribute(Qt::WA_DeleteOnClose);
+    d->setFileMode(QFileDialog::AnyFile);
+    d->setViewMode(QFileDialog::Detail);
+    d->setAcceptMode(QFileDialog::AcceptSave);
+    d->setConfirmOverwrite(true);
+    d->setDefaultSuffix("png");
+    d->setDirectory(f);
 
     f = "AScope-";
     f += QDateTime::currentDateTime().toString("yyyy-MM-dd-hh-mm-ss");
     f += ".png";
-    d.selectFile(f);
-    if (d.exec()) {
-        QStringList saveNames = d.selectedFiles();
-        _scopePlot->saveImageToFile(saveNames[0].toStdString());
-        f = d.directory().absolutePath();
-        _saveDir = f.toStdString();
+    d->selectFile(f);
+
+    // Don't use exec(); the dialog must not hold up the data flow.
+    connect(d, SIGNAL(fileSelected(const QString&)),
+            this, SLOT(saveImageFileSlot(const QString&)));
+    connect(d, SIGNAL(rejected()), this, SLOT(saveImageCancelledSlot()));
+    d->open();
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::saveImageFileSlot(const QString& fileName) {
+    QObject* d = sender();
+    if (!d) {
+        return;
+    }
+    QImage image = d->property("image").value<QImage>();
+    d->setProperty("image", QVariant());
+    if (image.isNull()) {
+        return;
+    }
+
+    writeImage(image, fileName, false);
+
+    _saveDir = QFileInfo(fileName).absolutePath().toStdString();
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::saveImageCancelledSlot() {
+    // don't hold on to the image until the dialog is deleted
+    if (sender()) {
+        sender()->setProperty("image", QVariant());
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::setAutoSnapshot(double intervalSecs) {
+    if (intervalSecs <= 0.0) {
+        _snapshotTimer->stop();
+        return;
     }
+
+    int interval = (int)(1000*intervalSecs);
+    if (interval < 1) {
+        interval = 1;
+    }
+    _snapshotTimer->start(interval);
 }
+
 //////////////////////////////////////////////////////////////////////
-void AScope::processTimeSeries(
-        std::vector<double>& Idata,
-        std::vector<double>& Qdata) {
+void AScope::autoSnapshotSlot() {
+    QString f = "AScope-";
+    f += QDateTime::currentDateTime().toString("yyyy-MM-dd-hh-mm-ss-zzz");
+    f += ".png";
+
+    QString path = QDir(_saveDir.c_str()).filePath(f);
+
+    // If the disk is falling behind, skip this snapshot rather
+    // than let the writes pile up.
+    writeImage(grabImage(), path, true);
+}
+
+//////////////////////////////////////////////////////////////////////
+QImage AScope::grabImage() {
+    if (_tsPlotType == TS_RTI_PLOT) {
+        return QPixmap::grabWidget(_rtiPlot).toImage();
+    }
+    return QPixmap::grabWidget(_scopePlot).toImage();
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::writeImage(const QImage& image, const QString& fileName, bool dropIfBusy) {
+    if (dropIfBusy && _imagesInFlight > 0) {
+        return;
+    }
+
+    _imagesInFlight.ref();
+    _imagePool.start(new ImageWriter(image, fileName, &_imagesInFlight));
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::frameSlot(int id, ScopeFramePtr frame) {
+    if (id != _subscriberId) {
+        return;
+    }
+    _awaitingFrame = false;
+
+    // A frame asked for before the pause is dropped, so that
+    // the history stays as it was when the display was frozen.
+    if (_paused) {
+        return;
+    }
+    // keep the frame, so that it can be seen again after
+    // the display is frozen
+    _shownSerial = _history.push(frame);
+
+    double start = now();
+    processFrame(*frame);
+    double render = now() - start;
+    emit frameDisplayed(frame);
+
+    // where the time went between acquisition and the screen
+    _latency[INGEST_QUEUE].add(frame->queueSecs);
+    _latency[PROCESSING].add(frame->processingSecs);
+    _latency[DELIVERY].add(start - frame->readyTime);
+    _latency[RENDER].add(render);
+    if (frame->timestamp > 0.0) {
+        _latency[DATA_AGE].add(wallClock() - frame->timestamp);
+    }
+    showLatency();
+
+    // track the cost of a frame, and pace the requests to it
+    const double alpha = 0.2;
+    _renderSecs += alpha*(render - _renderSecs);
+    // the engine's work only loads this thread if it has no workers
+    if (_engine->workerConfig().workers == 0) {
+        _processSecs += alpha*(frame->processingSecs - _processSecs);
+    }
+    adaptRefresh();
+
+    // in single shot mode, freeze on the first triggered
+    // block; un-pausing re-arms the trigger.
+    if (frame->triggered && _singleShot) {
+        _pauseButton->setChecked(true);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::processFrame(const ScopeFrame& frame, bool live) {
 
 	// if we are not plotting time series, ignore
     if (!_IQplot)
         return;
 
+    if (frame.sampleRateHz != _sampleRateHz) {
+        // keep the zoom center in the band
+        _sampleRateHz = frame.sampleRateHz;
+        _zoomCenter->setRange(-_sampleRateHz/2.0, _sampleRateHz/2.0);
+    }
+
+    const std::vector<double>& Idata = frame.I;
+    const std::vector<double>& Qdata = frame.Q;
+
     switch (_tsPlotType) {
     // power spectrum plot
     case TS_SPECTRUM_PLOT: {
-        // compute the power spectrum
-        _zeroMoment = powerSpectrum(Idata, Qdata);
+        // the spectrum may be missing if the plot type
+        // changed while the frame was being collected
+        if (frame.spectrum.empty()) {
+            break;
+        }
+        _spectrum = frame.spectrum;
+        _spectrumZoom = frame.zoom;
+        _spectrumCenterHz = frame.zoomCenterHz;
+        _zeroMoment = frame.spectrumZeroMoment;
+        _moments = frame.moments;
         displayData();
+        // the moments of a spectrum along the beam mean nothing
+        if (live && !frame.alongBeam) {
+            emit spectralMoments(frame.channel, frame.gate, _zeroMoment,
+                    _moments.noisePower, _moments.snr,
+                    _moments.meanFreq, _moments.width, _moments.peakFreq);
+        }
         break;
     }
     // I Q in time or I versus Q
@@ -295,19 +668,141 @@ void AScope::processTimeSeries(
     	for (unsigned int i = 0; i < Y.size(); i++) {
     		Y[i] = sqrt(Idata[i]*Idata[i] + Qdata[i]*Qdata[i]);
     	}
-        _zeroMoment = zeroMomentFromTimeSeries(Idata, Qdata);
+        _zeroMoment = frame.zeroMoment;
         displayData();
     	break;
     case TS_IVSQ_PLOT:
     case TS_IANDQ_PLOT:{
-        I.resize(Idata.size());
-        Q.resize(Qdata.size());
         I = Idata;
         Q = Qdata;
-        _zeroMoment = zeroMomentFromTimeSeries(Idata, Qdata);
+        _zeroMoment = frame.zeroMoment;
+        displayData();
+        break;
+    }
+    // dual channel products
+    case TS_CROSS_SPECTRUM_PLOT:
+    case TS_COHERENCE_PLOT:
+    case TS_CROSS_PHASE_PLOT:
+    case TS_DIFF_POWER_PLOT: {
+        // frames from before the switch to these plots have no products
+        if (frame.pairChannel < 0) {
+            break;
+        }
+        const CrossSpectra& cross = frame.cross;
+        switch (_tsPlotType) {
+        case TS_CROSS_SPECTRUM_PLOT:
+            _spectrum = cross.cross;
+            break;
+        case TS_COHERENCE_PLOT:
+            _spectrum = cross.coherence;
+            break;
+        case TS_CROSS_PHASE_PLOT:
+            _spectrum = cross.phase;
+            break;
+        default:
+            _spectrum = cross.differential;
+            break;
+        }
+        _crossSummary = QString("Chan %1/%2: diff power %3 dB, corr %4, phase %5 deg")
+                .arg(frame.channel).arg(frame.pairChannel)
+                .arg(cross.differentialPower, 0, 'f', 2)
+                .arg(cross.correlation, 0, 'f', 3)
+                .arg(cross.phaseDeg, 0, 'f', 1);
+        _zeroMoment = frame.zeroMoment;
+        displayData();
+        break;
+    }
+    // long term power statistics of every gate; the frame
+    // just says which channel and when
+    case TS_GATE_STATS_PLOT: {
+        GateStats stats = _engine->gateStats(frame.channel);
+        int gates = stats.gates();
+        if (gates == 0) {
+            break;
+        }
+        // the mean and the peak power of each gate, in dB
+        I.resize(gates);
+        Q.resize(gates);
+        int hottest = 0;
+        double p = 0.0;
+        for (int g = 0; g < gates; g++) {
+            I[g] = 10.0*log10(stats.mean()[g] + 1.0e-20);
+            Q[g] = 10.0*log10(stats.max()[g] + 1.0e-20);
+            if (stats.mean()[g] > stats.mean()[hottest]) {
+                hottest = g;
+            }
+            p += stats.mean()[g];
+        }
+        // the spread relative to the mean is 1 for pure noise
+        double spread = sqrt(stats.variance(hottest))/(stats.mean()[hottest] + 1.0e-20);
+        // the statistics are kept for the gates in the window
+        _statsSummary = QString("Gate (chan %1, %2 pulses, hottest gate %3: mean %4 dB, std dev/mean %5)")
+                .arg(frame.channel).arg(stats.count()).arg(_engine->gateWindow().gate(hottest))
+                .arg(I[hottest], 0, 'f', 1)
+                .arg(spread, 0, 'f', 2);
+        _zeroMoment = 10.0*log10(p/gates + 1.0e-20);
         displayData();
         break;
     }
+    // targets along the beam
+    case TS_CFAR_PLOT: {
+        // frames from before the switch to this plot have no threshold
+        if (!frame.cfar.enabled() || frame.cfarThreshold.empty()) {
+            break;
+        }
+        // the power and the detection threshold of each gate, in dB
+        int gates = frame.cfarThreshold.size();
+        I.resize(gates);
+        Q.resize(gates);
+        for (int g = 0; g < gates; g++) {
+            I[g] = 10.0*log10(frame.I[g]*frame.I[g] + frame.Q[g]*frame.Q[g] + 1.0e-20);
+            Q[g] = frame.cfarThreshold[g];
+        }
+        _detections = frame.detections;
+        // list the strongest few in the label
+        CfarDetections strongest(_detections);
+        std::sort(strongest.begin(), strongest.end(), strongerTarget);
+        _cfarSummary = QString("Gate (chan %1, %2 targets")
+                .arg(frame.channel).arg((int)_detections.size());
+        for (unsigned int i = 0; i < strongest.size() && i < 4; i++) {
+            _cfarSummary += QString("%1 gate %2 +%3 dB")
+                    .arg(i ? "," : ":")
+                    .arg(strongest[i].gate)
+                    .arg(strongest[i].snr, 0, 'f', 1);
+        }
+        _cfarSummary += ")";
+        _zeroMoment = frame.zeroMoment;
+        displayData();
+        if (live) {
+            emit targetsDetected(frame.channel, _detections);
+        }
+        break;
+    }
+    // range-time intensity
+    case TS_RTI_PLOT: {
+        // frames from before the switch to this plot have no profiles
+        if (frame.profileCount == 0) {
+            break;
+        }
+        const float* profiles = &frame.profiles[0];
+        int gates = frame.gates;
+        PlotInfo* pi = &_tsPlotInfo[_tsPlotType];
+        if (pi->autoscale()) {
+            std::vector<double> powers(profiles, profiles + frame.profiles.size());
+            autoScale(powers, TS_RTI_PLOT);
+            pi->autoscale(false);
+        }
+        // show the mean power of the newest beam
+        const float* newest = profiles + (frame.profileCount - 1)*gates;
+        double p = 0.0;
+        for (int g = 0; g < gates; g++) {
+            p += pow(10.0, newest[g]/10.0);
+        }
+        _zeroMoment = 10.0*log10(p/gates);
+        displayData();
+        _rtiPlot->addProfiles(profiles, frame.profileCount, gates);
+        break;
+    }
     default:
         // ignore others
         break;
@@ -322,6 +817,18 @@ void AScope::displayData() {
     QString l = QString("%1").arg(_zeroMoment, 6, 'f', 1);
     _powerDB->setText(l);
 
+    // the spectral moments go with the spectrum in time
+    QString moments;
+    if (_tsPlotType == TS_SPECTRUM_PLOT && !_alongBeam) {
+        moments = QString("Noise %1 dB  SNR %2 dB  Mean %3 Hz  Width %4 Hz  Peak %5 Hz")
+                .arg(_moments.noisePower, 0, 'f', 1)
+                .arg(std::max(_moments.snr, -99.9), 0, 'f', 1)
+                .arg(_moments.meanFreq, 0, 'f', 1)
+                .arg(_moments.width, 0, 'f', 1)
+                .arg(_moments.peakFreq, 0, 'f', 1);
+    }
+    _momentsLabel->setText(moments);
+
     // Time series data display
     PlotInfo* pi = &_tsPlotInfo[_tsPlotType];
 
@@ -352,75 +859,78 @@ void AScope::displayData() {
         }
         _scopePlot->IvsQ(I, Q, yBottom, yTop, 1, "I", "Q");
         break;
-    case TS_SPECTRUM_PLOT:
+    case TS_SPECTRUM_PLOT: {
+        if (pi->autoscale() || _continuousAutoscale) {
+            noiseAutoScale();
+            pi->autoscale(false);
+        }
+        // A zoomed spectrum spans 1/zoom of the sample rate, and
+        // its frequencies are relative to the zoom center.
+        std::string specLabel("Frequency (Hz)");
+        if (_spectrumZoom > 1) {
+            specLabel = QString("Frequency offset from %1 Hz (Hz)")
+                    .arg(_spectrumCenterHz, 0, 'f', 1).toStdString();
+        }
+        _scopePlot->Spectrum(
+        		_spectrum,
+        		_specGraphCenter -_specGraphRange/2.0,
+        		_specGraphCenter +_specGraphRange/2.0,
+        		_sampleRateHz/_spectrumZoom,
+        		false,
+                specLabel,
+                "Power (dB)");
+        break;
+    }
+    case TS_CROSS_SPECTRUM_PLOT:
+    case TS_DIFF_POWER_PLOT: {
         if (pi->autoscale()) {
             autoScale(_spectrum, displayType);
             pi->autoscale(false);
         }
+        std::string ylabel = (displayType == TS_CROSS_SPECTRUM_PLOT) ?
+                "Cross Power (dB)" : "Differential Power (dB)";
         _scopePlot->Spectrum(
         		_spectrum,
         		_specGraphCenter -_specGraphRange/2.0,
         		_specGraphCenter +_specGraphRange/2.0,
         		_sampleRateHz,
         		false,
-                "Frequency (Hz)",
-                "Power (dB)");
+                _crossSummary.toStdString(),
+                ylabel);
         break;
     }
-}
-
-//////////////////////////////////////////////////////////////////////
-double AScope::powerSpectrum(
-        std::vector<double>& Idata,
-        std::vector<double>& Qdata) {
-
-    _spectrum.resize(_blockSize);
-
-    unsigned int n = (Idata.size() <_blockSize) ? Idata.size(): _blockSize;
-    for (unsigned int j = 0; j < n; j++) {
-        // transfer the data to the fftw input space
-        _fftwData[j][0] = Idata[j];
-        _fftwData[j][1] = Qdata[j];
-    }
-    // zero pad if necessary
-    for (unsigned int j = n; j < _blockSize; j++) {
-        _fftwData[j][0] = 0;
-        _fftwData[j][1] = 0;
-    }
-
-    // apply the hamming window to the time series
-    if (_doHamming) {
-      doHamming();
+    case TS_COHERENCE_PLOT:
+        // the coherence and the phase have fixed scales
+        _scopePlot->Spectrum(_spectrum, 0.0, 1.0, _sampleRateHz, false,
+                _crossSummary.toStdString(), "Coherence");
+        break;
+    case TS_CROSS_PHASE_PLOT:
+        _scopePlot->Spectrum(_spectrum, -180.0, 180.0, _sampleRateHz, false,
+                _crossSummary.toStdString(), "Cross Phase (deg)");
+        break;
+    case TS_GATE_STATS_PLOT:
+        if (pi->autoscale()) {
+            autoScale(I, Q, displayType);
+            pi->autoscale(false);
+        }
+        _scopePlot->IandQ(I, Q, yBottom, yTop, 1, _statsSummary.toStdString(),
+                "Mean, Max Power (dB)");
+        break;
+    case TS_CFAR_PLOT:
+        if (pi->autoscale()) {
+            autoScale(I, Q, displayType);
+            pi->autoscale(false);
+        }
+        _scopePlot->IandQ(I, Q, yBottom, yTop, 1, _cfarSummary.toStdString(),
+                "Power, Threshold (dB)");
+        break;
+    case TS_RTI_PLOT:
+        // the color scale covers the same range as the spectrum's y axis
+        _rtiPlot->setRange(
+        		_specGraphCenter -_specGraphRange/2.0,
+        		_specGraphCenter +_specGraphRange/2.0);
+        break;
     }
-
-    // caclulate the fft
-    fftw_execute(_fftwPlan);
-
-    double zeroMoment = 0.0;
-
-    // reorder and copy the results into _spectrum
-    
-    int nHalf = _blockSize / 2;
-    double nSq = (double) _blockSize * (double) _blockSize;
-
-    for (unsigned int i = 0; i < _blockSize; i++) {
-
-      double pow =
-        _fftwData[i][0] * _fftwData[i][0] +
-        _fftwData[i][1] * _fftwData[i][1];
-      
-      zeroMoment += pow;
-      
-      pow /= nSq;
-      pow = 10.0*log10(pow);
-      _spectrum[(i + nHalf) % _blockSize] = pow;
-
-    } // i
-
-    zeroMoment /= nSq;
-    zeroMoment = 10.0*log10(zeroMoment);
-
-    return zeroMoment;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -470,8 +980,33 @@ void AScope::plotTypeChange(
     // set the knobs for the new plot type
     _gainKnob->setValue(_knobGain);
 
+     // the range-time display takes the place of the scope plot
+     bool rti = (newPlotType == TS_RTI_PLOT);
+     if (rti && _tsPlotType != TS_RTI_PLOT) {
+         _rtiPlot->clear();
+     }
      _tsPlotType = newPlotType;
 
+     // The gate statistics cost a pass over every gate of every
+     // pulse, so the engine may not keep them; if so, have it keep
+     // them while they are shown.
+     bool stats = (newPlotType == TS_GATE_STATS_PLOT);
+     if (stats && !_engine->gateStatsEnabled()) {
+         _engine->setGateStatsEnabled(true);
+         _gateStatsForPlot = true;
+     } else if (!stats && _gateStatsForPlot) {
+         _engine->setGateStatsEnabled(false);
+         _gateStatsForPlot = false;
+     }
+
+     _scopePlot->setVisible(!rti);
+     _rtiPlot->setVisible(rti);
+
+     // the engine needs to know if we want spectra
+     updateSelection();
+
+     // the history label depends on the plot type
+     showHistory();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -487,6 +1022,24 @@ void AScope::initPlots() {
     _tsPlotInfo[TS_IVSQ_PLOT]      = PlotInfo(3, TS_IVSQ_PLOT, "I vs Q", "I vs Q", -5.0, 5.0, 0.0, -5.0, 5.0, 0.0);
     _tsPlotInfo[TS_SPECTRUM_PLOT]  = PlotInfo(4, TS_SPECTRUM_PLOT, "Power Spectrum", "Power Spectrum", -5.0, 5.0, 0.0, -5.0, 5.0, 0.0);
 
+    _rangePlots.insert(TS_RTI_PLOT);
+    _rangePlots.insert(TS_GATE_STATS_PLOT);
+    _rangePlots.insert(TS_CFAR_PLOT);
+
+    _tsPlotInfo[TS_RTI_PLOT]       = PlotInfo(5, TS_RTI_PLOT, "Range-Time", "Range-Time Intensity", -5.0, 5.0, 0.0, -5.0, 5.0, 0.0);
+    _tsPlotInfo[TS_GATE_STATS_PLOT] = PlotInfo(10, TS_GATE_STATS_PLOT, "Gate Statistics", "Gate Statistics", -5.0, 5.0, 0.0, -5.0, 5.0, 0.0);
+    _tsPlotInfo[TS_CFAR_PLOT]       = PlotInfo(11, TS_CFAR_PLOT, "CFAR Detection", "CFAR Detection", -5.0, 5.0, 0.0, -5.0, 5.0, 0.0);
+
+    _crossPlots.insert(TS_CROSS_SPECTRUM_PLOT);
+    _crossPlots.insert(TS_COHERENCE_PLOT);
+    _crossPlots.insert(TS_CROSS_PHASE_PLOT);
+    _crossPlots.insert(TS_DIFF_POWER_PLOT);
+
+    _tsPlotInfo[TS_CROSS_SPECTRUM_PLOT] = PlotInfo(6, TS_CROSS_SPECTRUM_PLOT, "Cross Spectrum", "Cross Spectrum", -5.0, 5.0, 0.0, -5.0, 5.0, 0.0);
+    _tsPlotInfo[TS_COHERENCE_PLOT]      = PlotInfo(7, TS_COHERENCE_PLOT, "Coherence", "Coherence", -5.0, 5.0, 0.0, -5.0, 5.0, 0.0);
+    _tsPlotInfo[TS_CROSS_PHASE_PLOT]    = PlotInfo(8, TS_CROSS_PHASE_PLOT, "Cross Phase", "Cross Phase", -5.0, 5.0, 0.0, -5.0, 5.0, 0.0);
+    _tsPlotInfo[TS_DIFF_POWER_PLOT]     = PlotInfo(9, TS_DIFF_POWER_PLOT, "Differential Power", "Differential Power", -5.0, 5.0, 0.0, -5.0, 5.0, 0.0);
+
     // remove the one tab that was put there by designer
     _typeTab->removeTab(0);
 
@@ -494,12 +1047,17 @@ void AScope::initPlots() {
     // for each tab. This code is here to support
     // addition of new tabs for grouping display types,
     // such as an I and Q tab, a Products tab, etc.
-    // Right now it is only creating an I and Q tab.
     QButtonGroup* pGroup;
 
     pGroup = addTSTypeTab("I & Q", _pulsePlots);
     _tabButtonGroups.push_back(pGroup);
 
+    pGroup = addTSTypeTab("Range", _rangePlots);
+    _tabButtonGroups.push_back(pGroup);
+
+    pGroup = addTSTypeTab("Dual Channel", _crossPlots);
+    _tabButtonGroups.push_back(pGroup);
+
     connect(_typeTab, SIGNAL(currentChanged(QWidget *)),
             this, SLOT(tabChangeSlot(QWidget*)));
 }
@@ -549,7 +1107,22 @@ QButtonGroup* AScope::addTSTypeTab(
 
 //////////////////////////////////////////////////////////////////////
 void AScope::timerEvent(QTimerEvent*) {
-	_capture = true;
+	// Ask for the next frame. Nothing is asked for while paused, so
+	// that the history is frozen with the display, and a single shot
+	// trigger is not re-armed; the engine keeps ingesting regardless.
+	// If the last one has not arrived, asking again would only queue
+	// another frame behind it.
+	if (!_paused && !_awaitingFrame) {
+		_engine->requestFrame(_subscriberId);
+		_awaitingFrame = true;
+	}
+
+	// bump the activity bar if data are flowing
+	long long count = _engine->itemCount();
+	if (count != _lastItemCount) {
+		_activityBar->setValue((_activityBar->value()+1) % 100);
+		_lastItemCount = count;
+	}
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -573,7 +1146,10 @@ void AScope::upSlot() {
 
     if (_IQplot) {
         PlotInfo* pi = &_tsPlotInfo[_tsPlotType];
-        if (pi->getDisplayType() == ScopePlot::SPECTRUM) {
+        if (pi->getDisplayType() == ScopePlot::SPECTRUM ||
+                pi->getDisplayType() == TS_RTI_PLOT ||
+                pi->getDisplayType() == TS_CROSS_SPECTRUM_PLOT ||
+                pi->getDisplayType() == TS_DIFF_POWER_PLOT) {
             spectrum = true;
         }
     }
@@ -593,7 +1169,10 @@ void AScope::dnSlot() {
 
     if (_IQplot) {
         PlotInfo* pi = &_tsPlotInfo[_tsPlotType];
-        if (pi->getDisplayType() == ScopePlot::SPECTRUM) {
+        if (pi->getDisplayType() == ScopePlot::SPECTRUM ||
+                pi->getDisplayType() == TS_RTI_PLOT ||
+                pi->getDisplayType() == TS_CROSS_SPECTRUM_PLOT ||
+                pi->getDisplayType() == TS_DIFF_POWER_PLOT) {
             spectrum = true;
         }
     }
@@ -616,8 +1195,9 @@ void AScope::autoScale(
         return;
 
     // find the min and max
-    double min = *std::min_element(data.begin(), data.end());
-    double max = *std::max_element(data.begin(), data.end());
+    double min;
+    double max;
+    DspKernels::get().minMax(&data[0], data.size(), &min, &max);
 
     // adjust the gains
     adjustGainOffset(min, max, displayType);
@@ -633,25 +1213,47 @@ void AScope::autoScale(
         return;
 
     // find the min and max
-    double min1 = *std::min_element(data1.begin(), data1.end());
-    double min2 = *std::min_element(data2.begin(), data2.end());
+    const DspKernels& kernels = DspKernels::get();
+    double min1, max1;
+    double min2, max2;
+    kernels.minMax(&data1[0], data1.size(), &min1, &max1);
+    kernels.minMax(&data2[0], data2.size(), &min2, &max2);
     double min = std::min(min1, min2);
-
-    double max1 = *std::max_element(data1.begin(), data1.end());
-    double max2 = *std::max_element(data2.begin(), data2.end());
     double max = std::max(max1, max2);
 
     // adjust the gains
     adjustGainOffset(min, max, displayType);
 }
 
+//////////////////////////////////////////////////////////////////////
+void AScope::noiseAutoScale() {
+    // The extreme bins of a spectrum jump around from one frame
+    // to the next; the noise floor and the peak do not. Show a
+    // margin below the floor, and above the peak or, if there
+    // is no signal, above the noise.
+    double bottom = _moments.noisePower - 10.0;
+    double top = std::max(_moments.peakPower, _moments.noisePower + 10.0) + 5.0;
+    _specGraphCenter = (bottom + top)/2.0;
+    _specGraphRange = top - bottom;
+    _knobGain = -log10(_specGraphRange);
+}
+
 //////////////////////////////////////////////////////////////////////
 void AScope::adjustGainOffset(
         double min,
         double max,
         AScope::TS_PLOT_TYPES displayType) {
 
-    if (displayType == TS_SPECTRUM_PLOT) {
+    if (displayType == TS_RTI_PLOT) {
+        // span the color scale over the powers seen
+        _specGraphCenter = (min+max)/2.0;
+        _specGraphRange = max - min;
+        if (_specGraphRange <= 0.0) {
+            _specGraphRange = 1.0;
+        }
+    } else if (displayType == TS_SPECTRUM_PLOT ||
+            displayType == TS_CROSS_SPECTRUM_PLOT ||
+            displayType == TS_DIFF_POWER_PLOT) {
         // currently in spectrum plot mode
         _specGraphCenter = min + (max-min)/2.0;
         _specGraphRange = 3*(max-min);
@@ -674,56 +1276,30 @@ void AScope::adjustGainOffset(
 
 //////////////////////////////////////////////////////////////////////
 void
-AScope::newTSItemSlot(AScope::TimeSeries pItem) {
-
-	int chanId = pItem.chanId;
-	int tsLength = pItem.IQbeams.size();
-    _gates = pItem.gates;
-    _sampleRateHz = pItem.sampleRateHz;
-
-	if (!_combosInitialized) {
-		// initialize the combo selectors
-		initCombos(4, _gates);
-		_combosInitialized = true;
-
-	}
+AScope::newTSItemSlot(const AScope::TimeSeries& pItem) {
+	// The engine returns the item when it is done with it.
+	_engine->newTSItemSlot(pItem);
+}
 
-	if (chanId == _channel && !_paused && _capture) {
-        // extract the time series from the DDS sample
-        if (_alongBeam) {
-		_I.resize(_gates);
-		_Q.resize(_gates);
-		_nextIQ = 0;
-        	for (int i = 0; i < _gates; i++)  {
-        		_I[_nextIQ] = pItem.i(0, _nextIQ);
-        		_Q[_nextIQ] = pItem.q(0, _nextIQ);
-        		_nextIQ++;
-        	}
-        } else {
-        	for (int t = 0; t < tsLength; t++) {
-        		_I[_nextIQ] = pItem.i(t, _gateChoice);
-        		_Q[_nextIQ] = pItem.q(t, _gateChoice);
-        		_nextIQ++;
-        		if (_nextIQ == _I.size()) {
-        			break;
-        		}
-        	}
-        }
+//////////////////////////////////////////////////////////////////////
+void
+AScope::newTSBatchSlot(AScope::TimeSeriesBatch batch) {
+	// The engine returns the batch when it is done with it.
+	_engine->newTSBatchSlot(batch);
+}
 
-		// now see if we have collected enough samples
-        if (_nextIQ == _I.size()) {
-			// process the time series
-			processTimeSeries(_I, _Q);
-			_nextIQ = 0;
-			_capture = false;
-		}
+//////////////////////////////////////////////////////////////////////
+void AScope::gatesChangedSlot(int gates) {
+	// the gate choices depend on the data
+	_gates = gates;
+	if (_gateChoice >= _gates) {
+		_gateChoice = 0;
+		updateSelection();
 	}
-
-	// return the DDS item
-	emit returnTSItem(pItem);
-
-	// bump the activity bar
-	_activityBar->setValue((_activityBar->value()+1) % 100);
+	initGates(_gates);
+	_gateStart->setMaximum(_gates - 1);
+	_gateStop->setMaximum(_gates - 1);
+	_combosInitialized = true;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -739,79 +1315,213 @@ void AScope::autoScaleSlot() {
 void AScope::pauseSlot(
         bool p) {
     _paused = p;
+    _historySlider->setEnabled(_paused);
+    if (_paused) {
+        showHistory();
+    } else {
+        _historyLabel->clear();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::historySlot(int index) {
+    if (!_paused) {
+        return;
+    }
+    long long serial = _history.first() + index;
+    ScopeFramePtr frame = _history.frame(serial);
+    if (frame.isNull() || serial == _shownSerial) {
+        return;
+    }
+    _shownSerial = serial;
+
+    // the range-time display is already a history of its own,
+    // and its frames only hold the profiles since the one before;
+    // the gate statistics are the engine's live ones, and are not
+    // kept with the frames, so they are not replayed either
+    if (frame->profileCount == 0 && _tsPlotType != TS_GATE_STATS_PLOT) {
+        processFrame(*frame, false);
+    }
+    showHistory();
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::setHistoryLimits(int frames, size_t bytes) {
+    _history.setLimits(frames, bytes);
+    showHistory();
 }
 
 //////////////////////////////////////////////////////////////////////
 void AScope::channelSlot(int c) {
     _channel = c;
+    updateSelection();
 }
 
 //////////////////////////////////////////////////////////////////////
 void AScope::gateChoiceSlot(int index) {
-    _gateChoice = index;
+    _gateChoice = _gateNumber->itemData(index).toInt();
+    updateSelection();
 }
 
 //////////////////////////////////////////////////////////////////////
 void AScope::blockSizeSlot(int index) {
     unsigned int size = _blockSizeChoices[index];
 
-	// Reconfigure fftw if the size has changed
-	if (size != _blockSize) {
-		initFFT(size);
-		// save the size
-		_blockSize = size;
+	// save the size, and let the engine reconfigure
+	_blockSize = size;
+	updateSelection();
+}
+
+////////////////////////////////////////////////////////////////////////
+void
+AScope::windowSlot(bool flag) {
+	_doHamming = flag;
+	updateSelection();
+}
+
+////////////////////////////////////////////////////////////////////////
+void
+AScope::zoomSlot(int index) {
+	_zoom = _zoomCombo->itemData(index).toInt();
+	updateSelection();
+}
+
+////////////////////////////////////////////////////////////////////////
+void
+AScope::zoomCenterSlot(double hz) {
+	_zoomCenterHz = hz;
+	updateSelection();
+}
+
+////////////////////////////////////////////////////////////////////////
+void
+AScope::filterSlot(int index) {
+	if (index < 0 || index >= (int)_filterChoices.size()) {
+		return;
 	}
+	// decimation is not offered by the selector; keep what was set
+	int decimation = _preFilter.decimation;
+	_preFilter = _filterChoices[index];
+	_preFilter.decimation = decimation;
+	updateSelection();
+}
 
-	// If not in alongBeam mode, reconfigure _I and _Q capture
-	if (!_alongBeam) {
-		_I.resize(_blockSize);
-		_Q.resize(_blockSize);
-		_nextIQ = 0;
+////////////////////////////////////////////////////////////////////////
+void
+AScope::setPreFilter(const PreFilterSpec& spec) {
+	_preFilter = spec;
+
+	// show the matching selector choice, if there is one
+	PreFilterSpec undecimated = spec;
+	undecimated.decimation = 1;
+	for (unsigned int i = 0; i < _filterChoices.size(); i++) {
+		if (_filterChoices[i] == undecimated) {
+			_filterCombo->setCurrentIndex(i);
+			break;
+		}
 	}
+	updateSelection();
 }
 
 ////////////////////////////////////////////////////////////////////////
-double AScope::zeroMomentFromTimeSeries(
-		std::vector<double>& I,
-		std::vector<double>& Q) {
-    double p = 0;
-    int n = I.size();
+void
+AScope::triggerModeSlot(int index) {
+	_trigger.mode = TriggerSpec::Mode(_triggerCombo->itemData(index).toInt());
+	updateSelection();
+}
 
-    for (unsigned int i = 0; i < I.size(); i++) {
-        p += I[i]*I[i] + Q[i]*Q[i];
-    }
+////////////////////////////////////////////////////////////////////////
+void
+AScope::triggerLevelSlot(double level) {
+	_trigger.level = level;
+	updateSelection();
+}
 
-    p /= n;
-    p = 10.0*log10(p);
-    return p;
+////////////////////////////////////////////////////////////////////////
+void
+AScope::preTriggerSlot(int n) {
+	_trigger.preSamples = n;
+	updateSelection();
+}
+
+////////////////////////////////////////////////////////////////////////
+void
+AScope::singleShotSlot(bool flag) {
+	_singleShot = flag;
 }
 
 ////////////////////////////////////////////////////////////////////////
 void
-AScope::doHamming() {
+AScope::pairChannelSlot(int channel) {
+	_pairChannel = channel;
+	updateSelection();
+}
 
-  for (unsigned int i = 0; i < _blockSize; i++) {
-    _fftwData[i][0] *= _hammingCoefs[i];
-    _fftwData[i][1] *= _hammingCoefs[i];
-  }
+////////////////////////////////////////////////////////////////////////
+void
+AScope::setTrigger(const TriggerSpec& spec) {
+	_trigger = spec;
+	_triggerCombo->setCurrentIndex(_triggerCombo->findData(QVariant(int(spec.mode))));
+	_triggerLevel->setValue(spec.level);
+	_preTrigger->setValue(spec.preSamples);
+	updateSelection();
 }
 
 ////////////////////////////////////////////////////////////////////////
 void
-AScope::hammingSetup(int size) {
+AScope::cfarModeSlot(int index) {
+	_cfar.mode = CfarSpec::Mode(_cfarCombo->itemData(index).toInt());
+	updateSelection();
+}
 
-  _hammingCoefs.resize(size);
+////////////////////////////////////////////////////////////////////////
+void
+AScope::setCfar(const CfarSpec& spec) {
+	CfarSpec::Mode mode = _cfar.mode;
+	_cfar = spec;
+	if (!_cfar.enabled()) {
+		_cfar.mode = mode;
+	}
+	_cfarCombo->setCurrentIndex(_cfarCombo->findData(QVariant(int(_cfar.mode))));
+	updateSelection();
+}
 
-  for (int i = 0; i < size; i++) {
-    _hammingCoefs[i] = 0.54 - 0.46*(cos(2.0*M_PI*i/(size-1)));
-  }
+////////////////////////////////////////////////////////////////////////
+void
+AScope::gateWindowSlot() {
+	GateWindow window(_gateStart->value(), _gateStop->value(), _gateStride->value());
+	if (window == _gateWindow) {
+		return;
+	}
+	// the engine tells every view, this one included
+	_engine->setGateWindow(window);
+}
 
+////////////////////////////////////////////////////////////////////////
+void
+AScope::setGateWindow(const GateWindow& window) {
+	// the engine takes the window as given, even if it is beyond
+	// the range of the controls, and tells every view if it changes
+	_engine->setGateWindow(window);
+	gateWindowChangedSlot(_engine->gateWindow());
 }
 
 ////////////////////////////////////////////////////////////////////////
 void
-AScope::windowSlot(bool flag) {
-	_doHamming = flag;
+AScope::gateWindowChangedSlot(GateWindow window) {
+	// set the controls without a signal for each of them
+	_gateStart->blockSignals(true);
+	_gateStop->blockSignals(true);
+	_gateStride->blockSignals(true);
+	_gateStart->setValue(window.start);
+	_gateStop->setValue(window.stop);
+	_gateStride->setValue(window.stride);
+	_gateStart->blockSignals(false);
+	_gateStop->blockSignals(false);
+	_gateStride->blockSignals(false);
+
+	_gateWindow = window;
+	initGates(_gates);
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -819,61 +1529,189 @@ void
 AScope::alongBeamSlot(bool flag) {
 	_alongBeam = flag;
 
-	// If changing into alongBeam mode, set _I and _Q
-	// to the number of gates. Otherwise, set them to the
-	// blocksize.
-	if (_alongBeam) {
-		_I.resize(_gates);
-		_Q.resize(_gates);
-		_nextIQ = 0;
-		_gateNumber->setEnabled(false);
-	} else {
-		_I.resize(_blockSize);
-		_Q.resize(_blockSize);
-		_gateNumber->setEnabled(true);
-	}
-	_nextIQ = 0;
+	// In alongBeam mode, the engine collects all gates
+	// from one pulse. Otherwise it collects blocksize pulses
+	// from the selected gate.
+	_gateNumber->setEnabled(!_alongBeam);
+	_zoomCombo->setEnabled(!_alongBeam);
+	_zoomCenter->setEnabled(!_alongBeam);
+	_triggerCombo->setEnabled(!_alongBeam);
+	_triggerLevel->setEnabled(!_alongBeam);
+	_filterCombo->setEnabled(!_alongBeam);
+	_preTrigger->setEnabled(!_alongBeam);
+	_pairChannelBox->setEnabled(!_alongBeam);
+	updateSelection();
 }
 
 ////////////////////////////////////////////////////////////////////////
 AScope::TimeSeries::TimeSeries():
-dataType(VOIDDATA)
+dataType(VOIDDATA),
+timestamp(0.0)
 {
 }
 
 ////////////////////////////////////////////////////////////////////////
 AScope::TimeSeries::TimeSeries(TsDataTypeEnum type):
-dataType(type)
+dataType(type),
+timestamp(0.0)
 {
 	sampleRateHz = 10.0e6;
 }
 
 ////////////////////////////////////////////////////////////////////////
-double AScope::TimeSeries::i(int pulse, int gate) const {
-    switch (dataType) {
-        case FLOATDATA:
-            return(static_cast<float*>(IQbeams[pulse])[2 * gate]);
-        case SHORTDATA:
-            return(static_cast<short*>(IQbeams[pulse])[2 * gate]);
-        default:
-            std::cerr << "Attempt to extract data from " <<
-                "AScope::TimeSeries with data type unset!" << std::endl;
-            abort();
-    }
+AScope::TimeSeriesBatch::TimeSeriesBatch():
+handle(0),
+_shared(new Shared)
+{
 }
 
 ////////////////////////////////////////////////////////////////////////
-double AScope::TimeSeries::q(int pulse, int gate) const {
-    switch (dataType) {
-      case FLOATDATA:
-        return(static_cast<float*>(IQbeams[pulse])[2 * gate + 1]);
-      case SHORTDATA:
-        return(static_cast<short*>(IQbeams[pulse])[2 * gate + 1]);
-      default:
-        std::cerr << "Attempt to extract data from " <<
-        "AScope::TimeSeries with data type unset!" << std::endl;
-        abort();
-    }
+void
+AScope::TimeSeriesBatch::append(const TimeSeries& item) {
+	_shared->items.push_back(item);
+}
+
+////////////////////////////////////////////////////////////////////////
+void
+AScope::TimeSeriesBatch::appendBlock(TimeSeries::TsDataTypeEnum type, void* data,
+		int pulses, int gates, int chanId, double sampleRateHz, double timestamp) {
+	// fill the item in place, rather than copy its pulse pointers
+	_shared->items.push_back(TimeSeries(type));
+	TimeSeries& item = _shared->items.back();
+	item.gates = gates;
+	item.chanId = chanId;
+	item.sampleRateHz = sampleRateHz;
+	item.timestamp = timestamp;
+	item.handle = 0;
+
+	size_t sample = (type == TimeSeries::FLOATDATA) ? sizeof(float) : sizeof(short);
+	size_t stride = 2*sample*gates;
+	char* pulse = static_cast<char*>(data);
+	item.IQbeams.resize(pulses);
+	for (int p = 0; p < pulses; p++) {
+		item.IQbeams[p] = pulse + p*stride;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+const AScope::TimeSeries*
+AScope::TimeSeriesBatch::data() const {
+	return _shared->items.empty() ? 0 : &_shared->items[0];
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::setMaxRefreshRate(double hz) {
+	if (hz < 1.0) {
+		hz = 1.0;
+	}
+	_refreshIntervalHz = hz;
+	adaptRefresh();
+}
+
+//////////////////////////////////////////////////////////////////////
+double AScope::refreshRate() const {
+	return _timerIntervalMs > 0 ? 1000.0/_timerIntervalMs : _refreshIntervalHz;
+}
+
+//////////////////////////////////////////////////////////////////////
+LatencyStats AScope::latency(LatencyStage stage) const {
+	return _latency[stage];
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::showLatency() {
+	double t = now();
+	if (t - _latencyShownAt < 0.5) {
+		return;
+	}
+	_latencyShownAt = t;
+
+	// the age of the data drawn, and the 95th percentile of each
+	// stage, so that a slow producer, engine or gui stands out
+	const LatencyStats& age = _latency[DATA_AGE];
+	QString text = age.size() ?
+			QString("Age %1 ms").arg(age.last()*1.0e3, 0, 'f', 1) : QString("Age -");
+	text += QString("  p95 ms: queue %1  process %2  deliver %3  render %4")
+			.arg(_latency[INGEST_QUEUE].percentile(0.95)*1.0e3, 0, 'f', 1)
+			.arg(_latency[PROCESSING].percentile(0.95)*1.0e3, 0, 'f', 1)
+			.arg(_latency[DELIVERY].percentile(0.95)*1.0e3, 0, 'f', 1)
+			.arg(_latency[RENDER].percentile(0.95)*1.0e3, 0, 'f', 1);
+	_latencyLabel->setText(text);
+
+	// the full percentiles in the tool tip
+	const char* names[LATENCY_STAGES] = {"age", "queue", "process", "deliver", "render"};
+	QString tip("Latency, ms: p50 / p95 / p99 / max");
+	for (int s = 0; s < LATENCY_STAGES; s++) {
+		const LatencyStats& l = _latency[s];
+		tip += QString("\n%1: %2 / %3 / %4 / %5").arg(names[s])
+				.arg(l.percentile(0.5)*1.0e3, 0, 'f', 1)
+				.arg(l.percentile(0.95)*1.0e3, 0, 'f', 1)
+				.arg(l.percentile(0.99)*1.0e3, 0, 'f', 1)
+				.arg(l.percentile(1.0)*1.0e3, 0, 'f', 1);
+	}
+	_latencyLabel->setToolTip(tip);
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::showHistory() {
+	if (!_paused || _history.size() == 0) {
+		return;
+	}
+
+	// set the slider to the history, without a signal, so
+	// that it stays on the frame displayed while that is kept
+	long long shown = _shownSerial;
+	if (shown < _history.first()) {
+		shown = _history.first();
+	}
+	_historySlider->blockSignals(true);
+	_historySlider->setRange(0, _history.size() - 1);
+	_historySlider->setValue(shown - _history.first());
+	_historySlider->blockSignals(false);
+
+	// how far back the displayed frame is
+	ScopeFramePtr frame = _history.frame(_shownSerial);
+	if (frame.isNull()) {
+		_historyLabel->setText(QString("%1 frames, displayed frame dropped")
+				.arg(_history.size()));
+		return;
+	}
+	QString text = QString("Frame %1 of %2, %3 s ago")
+			.arg(_shownSerial - _history.first() + 1)
+			.arg(_history.size())
+			.arg(now() - frame->readyTime, 0, 'f', 1);
+	if (_tsPlotType == TS_GATE_STATS_PLOT) {
+		text += ", gate statistics are not replayed";
+	}
+	_historyLabel->setText(text);
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::setContinuousAutoscale(bool on) {
+	_continuousAutoscale = on;
+}
+
+//////////////////////////////////////////////////////////////////////
+void AScope::adaptRefresh() {
+	// Leave at least half of each interval for everything else
+	// the gui thread does, and never go faster than the limit.
+	double cost = _renderSecs + _processSecs;
+	int interval = (int)ceil(std::max(1000.0/_refreshIntervalHz, 2000.0*cost));
+	if (interval < 1) {
+		// require at least 1 ms pauses.
+		interval = 1;
+	}
+
+	// restarting the timer resets its phase, so only do
+	// it for a change of more than a few percent
+	if (_timerId && abs(interval - _timerIntervalMs) * 20 <= _timerIntervalMs) {
+		return;
+	}
+	if (_timerId) {
+		killTimer(_timerId);
+	}
+	_timerIntervalMs = interval;
+	_timerId = startTimer(interval);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -30,12 +30,16 @@
 #include <QWidget>
 #include <QPalette>
 #include <QButtonGroup>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <QImage>
+#include <QTimer>
 
 #include <qevent.h>
 #include <deque>
 #include <set>
 #include <map>
-#include <fftw3.h>
 
 // Components from the QtToolbox
 #include "ScopePlot.h"
@@ -46,6 +50,19 @@
 
 // PlotInfo knows the characteristics of a plot
 #include "PlotInfo.h"
+// ScopeFrame carries processed data from the engine
+#include "ScopeFrame.h"
+// PreFilter conditions the time series before the products are computed
+#include "PreFilter.h"
+// Trigger describes triggered capture
+#include "Trigger.h"
+// The range-time intensity display
+#include "RtiPlot.h"
+// Percentiles of recent latencies
+#include "LatencyStats.h"
+#include "FrameHistory.h"
+
+class AScopeEngine;
 
 /**
  AScope provides a traditional real-time Ascope display of
@@ -60,39 +77,44 @@
  anything about the data provider. Signals and slots
  used to coordinate with other components.
 
+ Construction is fast; the fftw plans and window tables for all of
+ the block sizes are built on a background thread. AScope emits
+ scopeReady() when they are done, and providers should wait for
+ this signal (or check isReady()) before starting to feed data.
+ Data delivered earlier are still processed, but the first spectrum
+ may pay for planning.
+
  It is the responsibility of the data provider to feed data
  at a desired rate. AScope will attempt to render all data
  delivered.
 
- There are two data areas, _I/_Q and _fftwData, that are dynamically
- resized depending upon the operational mode of the scope.
-
- _I and _Q contain the I/Q values that are being analyzed. They are
- filled as data is delivered to newTSItemSlot. They will be either
- be the same as the selected block size, if operating in fixed gate
- mode, or the number of gates if operating along beam mode.
-
- _fftwData is sized to the currently selected block size. Thus this will
- match _I/_Q sizes when operating in fixed gate mode. When in along beam mode,
- this probably not match the number of gates. The _fftwData will be zero padded
- if it is larger than _I/_Q size. If smaller, it will just be filled with
- the leading data from _I/_Q.
-
- Thus, _I/Q gets resized when the block size is changed, if not operating
- in along beam mode. It gets resized to the number of gates,
- when switching into along beam mode. It gets resized to the block size
- when leaving along beam mode.
+ The data collection and processing are done by an AScopeEngine.
+ AScope subscribes to the engine with its current selection of
+ channel, gate or along beam mode, block size, windowing, and whether
+ the current plot type needs a power spectrum. On each timer tick it
+ asks the engine for a new frame.
 
- Likewise, _fftwData gets resized when the block size changes. A new
- fftwPlan gets created at the same time.
+ The I and Q values that are analyzed will be either the same
+ as the selected block size, if operating in fixed gate mode, or
+ the number of gates if operating along beam mode. The fft is sized
+ to the currently selected block size. When in along beam mode,
+ this probably not match the number of gates. The time series will
+ be zero padded if it is shorter than the block size. If longer, only
+ the leading data are used.
 
  The processing of incoming data will be handled differently depending
  upon the type of plot that is currently selected. For instance, if
  a time series or I vs Q  plot by gate is chosen, I and Q are collected
  along the specified gate and displayed. If a power spectrum plot is
  chosen, the I and Q data are collected and then a power spectrum is
- computed. And so on. This work is done in newTSItemSlot(), and then
- the collected data are sent on to proper display method.
+ computed. The resulting ScopeFrame is delivered to frameSlot(),
+ and then the data are sent on to proper display method.
+
+ By default each AScope creates its own engine, and data are fed
+ through newTSItemSlot() and returned with returnTSItem(), as
+ always. Several AScopes can share one engine, in which case the
+ data provider should be connected to the engine itself; see
+ AScopeEngine.
 
  A small QFrame in the controls area is provided for users to add their
  own status widgets, branding, etc.
@@ -106,7 +128,25 @@ class AScope : public QWidget, private Ui::AScope {
             TS_AMPLITUDE_PLOT,  ///<  time series amplitude plot
             TS_IANDQ_PLOT,      ///<  time series I and Q plot
             TS_IVSQ_PLOT,       ///<  time series I versus Q plot
-            TS_SPECTRUM_PLOT    ///<  time series power spectrum plot
+            TS_SPECTRUM_PLOT,   ///<  time series power spectrum plot
+            TS_RTI_PLOT,        ///<  range-time intensity of beam power
+            TS_CROSS_SPECTRUM_PLOT, ///< cross spectrum of two channels
+            TS_COHERENCE_PLOT,  ///<  coherence of two channels
+            TS_CROSS_PHASE_PLOT, ///<  cross spectrum phase of two channels
+            TS_DIFF_POWER_PLOT, ///<  differential power spectrum of two channels
+            TS_GATE_STATS_PLOT, ///<  long term power statistics of each gate
+            TS_CFAR_PLOT        ///<  targets detected along the beam
+        };
+
+        /// The stages that data pass through on the way to the
+        /// screen, for latency().
+        enum LatencyStage {
+            DATA_AGE,       ///<  acquisition to drawn, when timestamped
+            INGEST_QUEUE,   ///<  waiting in the engine for ingest
+            PROCESSING,     ///<  making the frame
+            DELIVERY,       ///<  waiting for the gui thread
+            RENDER,         ///<  drawing the frame
+            LATENCY_STAGES  ///<  the number of stages
         };
         
      public:
@@ -143,6 +183,11 @@ class AScope : public QWidget, private Ui::AScope {
             int chanId;
             /// The sample rate, in Hz
             double sampleRateHz;
+            /// The acquisition time of the newest pulse, in seconds
+            /// since the epoch (as from gettimeofday()), or 0 if not
+            /// known. It is carried into the frames, so that the
+            /// scope can show how old the data on the screen are.
+            double timestamp;
             /// An opaque pointer that can be used to store
             /// anything that the caller wants to track along 
             /// with the TimeSeries. This will be useful when 
@@ -163,15 +208,70 @@ class AScope : public QWidget, private Ui::AScope {
             FloatTimeSeries() : TimeSeries(TimeSeries::FLOATDATA) {}
         };
 
+        /// A batch of items, delivered with one call of newTSBatchSlot()
+        /// and returned with one returnTSBatch(), so that the cost of
+        /// the signals is paid once per batch rather than once per item.
+        /// Copies of a batch share its items, so passing it through a
+        /// queued connection does not copy them. Fill the batch before
+        /// handing it over, and leave it alone until it is returned.
+        class TimeSeriesBatch {
+        public:
+            TimeSeriesBatch();
+            /// Append an item.
+            /// @param item The item.
+            void append(const TimeSeries& item);
+            /// Append a block of pulses that are contiguous in memory,
+            /// as one item. Each pulse follows the 2*gates samples of
+            /// the one before it.
+            /// @param type The sample type, FLOATDATA or SHORTDATA.
+            /// @param data The first pulse.
+            /// @param pulses The number of pulses.
+            /// @param gates The number of gates.
+            /// @param chanId The channel id.
+            /// @param sampleRateHz The sample rate, in Hz.
+            /// @param timestamp The acquisition time of the last pulse,
+            /// as for TimeSeries::timestamp.
+            void appendBlock(TimeSeries::TsDataTypeEnum type, void* data,
+                    int pulses, int gates, int chanId, double sampleRateHz,
+                    double timestamp = 0.0);
+            /// @return The number of items.
+            int size() const { return _shared->items.size(); }
+            /// @return An item.
+            /// @param i The item index.
+            const TimeSeries& operator[](int i) const { return _shared->items[i]; }
+            /// @return The items, which are contiguous, or null if
+            /// there are none.
+            const TimeSeries* data() const;
+            /// An opaque pointer for the caller's use, as for
+            /// TimeSeries::handle.
+            void* handle;
+        protected:
+            friend class ::AScopeEngine;
+            /// The part that the copies share
+            class Shared {
+            public:
+                /// The items
+                std::vector<TimeSeries> items;
+                /// The number of engine shards still ingesting the items
+                QAtomicInt shards;
+            };
+            /// The items, shared by the copies
+            QSharedPointer<Shared> _shared;
+        };
+
         /// Constructor
-        /// @param refreshRateHz The rate at which we want the display to
-        /// update. Data will be (nominally) collected at this rate.
+        /// @param refreshRateHz The highest rate at which we want the
+        /// display to update. The rate is lowered automatically if
+        /// processing and drawing a frame take too long for it.
         /// @param saveDir The default directory to save images in
         /// @param parent The parent widget.
+        /// @param engine The processing engine to subscribe to. If null,
+        /// a private engine is created.
         AScope(
         		double refreshRateHz = 25,
         		std::string saveDir = ".",
-        		QWidget* parent = 0);
+        		QWidget* parent = 0,
+        		AScopeEngine* engine = 0);
         /// Destructor
         virtual ~AScope();
         /// @return The user frame, available for adding your
@@ -179,6 +279,64 @@ class AScope : public QWidget, private Ui::AScope {
         /// in this area will really mess up the overall
         /// layout of the scope.
         QFrame* userFrame();
+        /// @return True if the background initialization has
+        /// finished, i.e. scopeReady() has been emitted.
+        bool isReady() const;
+        /// @return The engine that this scope subscribes to.
+        AScopeEngine* engine();
+        /// Set the conditioning applied to the time series before
+        /// the products are computed. The filter selector offers
+        /// the common choices; this allows any combination,
+        /// including decimation.
+        /// @param spec The pre-filter.
+        void setPreFilter(const PreFilterSpec& spec);
+        /// @return The pre-filter in use.
+        PreFilterSpec preFilter() const { return _preFilter; }
+        /// Set the one gate trigger. When enabled, the display
+        /// updates only on triggered blocks.
+        /// @param spec The trigger.
+        void setTrigger(const TriggerSpec& spec);
+        /// @return The trigger in use.
+        TriggerSpec trigger() const { return _trigger; }
+        /// Set the highest display update rate. The rate in effect
+        /// adapts, below this, to the measured cost of a frame.
+        /// @param hz The rate, in Hz; at least 1.
+        void setMaxRefreshRate(double hz);
+        /// @return The display update rate in effect, in Hz.
+        double refreshRate() const;
+        /// @return The recent latencies of a stage, over the last
+        /// frames displayed.
+        /// @param stage The stage.
+        LatencyStats latency(LatencyStage stage) const;
+        /// Rescale the power spectrum to every frame, rather than
+        /// only when the autoscale button is pressed. The scale
+        /// follows the noise floor and the peak, which are steady.
+        /// @param on True to rescale continuously.
+        void setContinuousAutoscale(bool on);
+        /// Set the target detection applied along the beam for the
+        /// CFAR Detection plot. The detector selector offers the
+        /// estimators; this allows any window and false alarm rate.
+        /// @param spec The detection. A spec that is not enabled
+        /// keeps the estimator in use.
+        void setCfar(const CfarSpec& spec);
+        /// @return The target detection in use.
+        CfarSpec cfar() const { return _cfar; }
+        /// @return The targets in the last beam displayed.
+        const CfarDetections& detections() const { return _detections; }
+        /// Limit the plots along the beam, and the gate selector, to a
+        /// window of gates. This is applied by the engine, so the work
+        /// follows the window too (see AScopeEngine::setGateWindow()).
+        /// @param window The gates of interest.
+        void setGateWindow(const GateWindow& window);
+        /// @return The window of gates.
+        GateWindow gateWindow() const { return _gateWindow; }
+        /// Set how much of the recent past is kept for scrubbing
+        /// through while paused.
+        /// @param frames The largest number of frames kept.
+        /// @param bytes The largest amount of frame data kept.
+        void setHistoryLimits(int frames, size_t bytes);
+        /// @return The recent frames.
+        const FrameHistory& history() const { return _history; }
 
     signals:
 		/// emit this signal to alert the client that we
@@ -188,11 +346,46 @@ class AScope : public QWidget, private Ui::AScope {
 		/// triggering of newTSItemSlot() and the emitting
 		/// of returnTSItem().
 		void returnTSItem(AScope::TimeSeries pItem);
+		/// emitted when the engine is done with all of the items
+		/// of a batch. The items are not returned one by one.
+		/// @param batch The batch delivered to newTSBatchSlot().
+		void returnTSBatch(AScope::TimeSeriesBatch batch);
+		/// emitted once, when the scope has finished its
+		/// background initialization and is ready for data.
+		void scopeReady();
+		/// emitted with the moments of each power spectrum that is
+		/// displayed, so that a client can follow them in time.
+		/// @param channel The channel.
+		/// @param gate The gate.
+		/// @param powerDb The zero moment, in dB.
+		/// @param noiseDb The noise power of a spectrum bin, in dB.
+		/// @param snrDb The signal to noise ratio, in dB.
+		/// @param meanHz The mean Doppler frequency, in Hz.
+		/// @param widthHz The spectrum width, in Hz.
+		/// @param peakHz The frequency of the strongest bin, in Hz.
+		void spectralMoments(int channel, int gate, double powerDb,
+				double noiseDb, double snrDb,
+				double meanHz, double widthHz, double peakHz);
+		/// emitted with the targets detected in each beam that is
+		/// displayed in the CFAR Detection plot.
+		/// @param channel The channel.
+		/// @param detections The targets, in gate order.
+		void targetsDetected(int channel, CfarDetections detections);
+		/// emitted with each frame that is displayed, for clients
+		/// that use the scope's products (see FramePublisher). The
+		/// frame is shared, not copied.
+		/// @param frame The frame.
+		void frameDisplayed(ScopeFramePtr frame);
 
     public slots:
-		/// Feed new timeseries data via this slot.
+		/// Feed new timeseries data via this slot. The data are
+		/// passed on to the engine.
 		/// @param pItem This contains some metadata and pointers to I/Q data
-		void newTSItemSlot(AScope::TimeSeries pItem);
+		void newTSItemSlot(const AScope::TimeSeries& pItem);
+		/// Feed a batch of items via this slot. The batch is passed
+		/// on to the engine, and comes back through returnTSBatch().
+		/// @param batch The items.
+		void newTSBatchSlot(AScope::TimeSeriesBatch batch);
        /// Call when the plot type is changed. This function
         /// must determine which of the two families of
         /// plots, _tsPlotInfo, or _productPlotInfo, the
@@ -214,11 +407,32 @@ class AScope : public QWidget, private Ui::AScope {
         /// Initiate an autoscale. A flag is set; during the next
         /// pulse reception an autoscale computation is made.
         virtual void autoScaleSlot();
-        /// Save the scope display to a PNG file.
+        /// Save the scope display to a PNG file. The display is
+        /// captured immediately; the file dialog is not modal with
+        /// respect to the data flow, and the image is encoded and
+        /// written on a background thread.
         void saveImageSlot();
-        /// Pause the plotting. Any received data are ignored.
+        /// Called when a file name has been chosen in the save dialog.
+        /// @param fileName The chosen file.
+        void saveImageFileSlot(const QString& fileName);
+        /// Called when the save dialog is cancelled.
+        void saveImageCancelledSlot();
+        /// Enable or disable unattended snapshots. Images are written to
+        /// the save directory, named with the capture time.
+        /// @param intervalSecs The interval between snapshots, in seconds.
+        /// A value <= 0 disables automatic snapshots.
+        void setAutoSnapshot(double intervalSecs);
+        /// Capture a snapshot into the save directory. Called from
+        /// the auto snapshot timer.
+        void autoSnapshotSlot();
+        /// Freeze the display, and the history of the frames before
+        /// it, which can be scrubbed through with historySlot().
         /// @param p True to enable pause.
         void pauseSlot(bool p);
+        /// Display a frame from the history, while paused.
+        /// @param index The index of the frame in the history,
+        /// oldest first.
+        void historySlot(int index);
         /// Select the channel
         /// @param c The channel (0-3)
         void channelSlot(int c);
@@ -232,39 +446,87 @@ class AScope : public QWidget, private Ui::AScope {
         void windowSlot(bool);
         /// Select long beam display
         void alongBeamSlot(bool);
+        /// Select the spectrum zoom factor
+        /// @param index The index from the combo box of the selected zoom.
+        void zoomSlot(int index);
+        /// Set the center frequency of the zoomed spectrum
+        /// @param hz The center frequency, in Hz.
+        void zoomCenterSlot(double hz);
+        /// Select the pre-filter
+        /// @param index The index from the combo box of the selected filter.
+        void filterSlot(int index);
+        /// Select the trigger condition
+        /// @param index The index from the combo box of the selected trigger.
+        void triggerModeSlot(int index);
+        /// Set the trigger level
+        /// @param level The level.
+        void triggerLevelSlot(double level);
+        /// Set the number of pre-trigger samples
+        /// @param n The number of samples.
+        void preTriggerSlot(int n);
+        /// Enable/disable single shot triggering
+        /// @param flag True to pause on the first triggered block.
+        void singleShotSlot(bool flag);
+        /// Select the second channel for the dual channel plots
+        /// @param channel The channel.
+        void pairChannelSlot(int channel);
+        /// Select the target detection estimator
+        /// @param index The index from the combo box of the selected estimator.
+        void cfarModeSlot(int index);
+        /// Called when the gate window controls change.
+        void gateWindowSlot();
+        /// Called when the engine's window of gates changes, by this
+        /// or another view; the controls and gate choices follow it.
+        /// @param window The new window.
+        void gateWindowChangedSlot(GateWindow window);
 
         /// Get the current block size
         unsigned int getBlockSize() const { return _blockSize; }
 
+    protected slots:
+        /// Called when the engine's background fft preparation has finished.
+        void fftPreparedSlot();
+        /// Receive a frame from the engine.
+        /// @param id The subscriber id that the frame is for.
+        /// @param frame The frame.
+        void frameSlot(int id, ScopeFramePtr frame);
+        /// Called when the number of gates in the data stream changes.
+        /// @param gates The number of gates.
+        void gatesChangedSlot(int gates);
+
     protected:
-        /// Initialize the block size choices. The minimum
-        /// size will be 32. The max size will be 4096.
-        /// @todo allow the max (and min?) block sizes to
-        /// be confiurable.
+        /// Initialize the block size choices, from
+        /// AScopeEngine::blockSizeChoices().
         void initBlockSizes();
-        /// Allocate the fftw space and create then plan.
-        /// Existing space and plan are returned first.
-        /// Set up the hammimg window coefficients.
-        /// @param size The fft length.
-        void initFFT(int size);
+        /// Initialize the spectrum zoom choices.
+        void initZoom();
+        /// Initialize the pre-filter choices.
+        void initFilters();
+        /// Initialize the trigger controls.
+        void initTrigger();
+        /// Initialize the target detection choices.
+        void initCfar();
         /// Initialize the gate selection 
         /// @param gates The number of gates.
         void initGates(int gates);
         /// Initialize the channel selection
         /// @param channels The number of channels.
 		void initChans(int channels);
-        /// Emit a signal announcing the desired gate mode,
-        /// either along beam, or one gate. The channel select,
-        /// gate choice and (for one gate mode) data block
-        /// size will be part of the emitted signal.
-        void dataMode();
+        /// Send our current channel, gate, block size, windowing
+        /// and plot type choices to the engine.
+        void updateSelection();
         /// Send the data for the current plot type to the ScopePlot.
         void displayData();
-        /// Setup the hamming coefficients.
-        /// @param size The number of coefficients.
-        void hammingSetup(int size);
-        /// Apply the hamming filter.
-        void doHamming();
+        /// Capture the current plot display. This is a cheap copy of
+        /// the rendered widget; no encoding is done.
+        /// @return The captured image.
+        QImage grabImage();
+        /// Queue an image to be written by the background image writer.
+        /// @param image The image to write.
+        /// @param fileName The destination file.
+        /// @param dropIfBusy If true, the image is discarded if previous
+        /// writes have not yet completed.
+        void writeImage(const QImage& image, const QString& fileName, bool dropIfBusy);
         /// Autoscale based on a set of data.
         /// @param data The data series to be analyzed.
         /// @param displayType The type of plot that the data is scaled for.
@@ -279,10 +541,11 @@ class AScope : public QWidget, private Ui::AScope {
                 std::vector<double>& data1,
                 std::vector<double>& data2,
                 TS_PLOT_TYPES displayType);
-        /// Initialize the combo box choices and FFTs.
+        /// Initialize the block size and channel choices. The gate
+        /// choices are initialized when the number of gates is
+        /// known from the data.
         /// @param channels The number of channels,
-        /// @param gates The number of gates
-        void initCombos(int channels, int gates);
+        void initCombos(int channels);
         /// Adjust the _graphRange and _graphOffset values.
         /// @param min Desired scale minimum
         /// @param max Desired scale maximum
@@ -291,21 +554,14 @@ class AScope : public QWidget, private Ui::AScope {
                 double min,
                 double max,
                 TS_PLOT_TYPES displayType);
-        /// Process time series data.
-        /// @param Idata The I values
-        /// @param Qdata The Q values
-        void processTimeSeries(
-                std::vector<double>& Idata,
-                std::vector<double>& Qdata);
-        /// Compute the power spectrum. The input values will come
-        /// I[]and Q[], the power spectrum will be written to
-        /// _spectrum[]
-        /// @param Idata The I time series.
-        /// @param Qdata The Q time series.
-        /// @return The zero moment
-        double powerSpectrum(
-                std::vector<double>& Idata,
-                std::vector<double>& Qdata);
+        /// Scale the power spectrum from its noise floor to its peak.
+        void noiseAutoScale();
+        /// Extract the data for the current plot type from a frame,
+        /// and display them.
+        /// @param frame The frame.
+        /// @param live False if the frame is replayed from the history,
+        /// in which case its products are not emitted again.
+        void processFrame(const ScopeFrame& frame, bool live = true);
         /// initialize all of the book keeping structures
         /// for the various plots.
         void initPlots();
@@ -321,13 +577,17 @@ class AScope : public QWidget, private Ui::AScope {
         QButtonGroup* addTSTypeTab(
                 std::string tabName,
                 std::set<TS_PLOT_TYPES> types);
-        /// Calculate the zeroth moment, using the time
-        /// series for input.
-        double zeroMomentFromTimeSeries(
-                std::vector<double>& I,
-                std::vector<double>& Q);
-       // The builtin timer will be used to calculate beam statistics.
+       // The builtin timer is used to request frames from the engine.
         void timerEvent(QTimerEvent*);
+        /// Adjust the frame request interval to the smoothed cost
+        /// of a frame, within the rate limit.
+        void adaptRefresh();
+        /// Show the data age and the latency percentiles, at most
+        /// twice a second.
+        void showLatency();
+        /// Bring the history slider and label up to date with
+        /// the frames kept and the one displayed.
+        void showHistory();
         /// For each TS_PLOT_TYPES, there will be an entry in this map.
         std::map<TS_PLOT_TYPES, PlotInfo> _tsPlotInfo;
         /// This set contains PLOTTYPEs for all timeseries plots
@@ -338,6 +598,13 @@ class AScope : public QWidget, private Ui::AScope {
         std::vector<QButtonGroup*> _tabButtonGroups;
         /// This set contains PLOTTYPEs for all raw data plots
         std::set<TS_PLOT_TYPES> _pulsePlots;
+        /// This set contains PLOTTYPEs for the plots over range
+        std::set<TS_PLOT_TYPES> _rangePlots;
+        /// This set contains PLOTTYPEs for the dual channel plots
+        std::set<TS_PLOT_TYPES> _crossPlots;
+        /// The range-time intensity display, shown in place
+        /// of the scope plot when that plot type is selected
+        RtiPlot* _rtiPlot;
         /// Holds Y data to display for  TimeSeries display
         std::vector<double> Y;
         /// Holds I data to display for  I vs. Q
@@ -346,33 +613,77 @@ class AScope : public QWidget, private Ui::AScope {
         std::vector<double> Q;
         /// Holds power spectrum values for display.
         std::vector<double> _spectrum;
-        // how often to update the display
+        /// The most often to update the display, in Hz
         double _refreshIntervalHz;
+        /// The id of the frame request timer
+        int _timerId;
+        /// The frame request interval in effect, in ms
+        int _timerIntervalMs;
+        /// True from a frame request until its frame arrives; no
+        /// other frame is requested meanwhile, so that frames
+        /// cannot queue up behind a slow display.
+        bool _awaitingFrame;
+        /// The smoothed time to draw a frame, in seconds
+        double _renderSecs;
+        /// The smoothed time the engine took to make a frame, in seconds,
+        /// when it works in the gui thread; 0 if it has workers
+        double _processSecs;
+        /// Set true if the gate statistics were turned on for the
+        /// Gate Statistics plot, to be turned off again when it goes
+        bool _gateStatsForPlot;
+        /// The recent latencies, by LatencyStage
+        LatencyStats _latency[LATENCY_STAGES];
+        /// When the latencies were last shown, in seconds
+        double _latencyShownAt;
+        /// The recent frames, for scrubbing while paused
+        FrameHistory _history;
+        /// The history serial number of the frame displayed
+        long long _shownSerial;
         /// Set true when a plot is chosen which shows results
         /// from IQ data. If a plot of products is chosen,
         /// it is false.
         bool _IQplot;
         /// The current selected plot type.
         TS_PLOT_TYPES _tsPlotType;
-         /// The hamming window coefficients
-        std::vector<double> _hammingCoefs;
         /// The possible block/fftw size choices.
         std::vector<int> _blockSizeChoices;
-        ///	The fftw plan. This is a handle used by
-        ///	the fftw routines.
-        //std::vector<fftw_plan> _fftwPlan;
-        fftw_plan _fftwPlan;
-        ///	The fftw data array. The fft will
-        //	be performed in place, so both input data
-        ///	and results are stored here.
-        //std::vector<fftw_complex*> _fftwData;
-        fftw_complex* _fftwData;
+        /// Set true if the Hamming window should be applied
+        bool _doHamming;
         //	power correction factor applied to (uncorrected) powerSpectrum() output
         double _powerCorrection;
         /// The current block size
         unsigned int _blockSize;
-        /// Set true if the Hamming window should be applied
-        bool _doHamming;
+        /// The selected spectrum zoom factor
+        int _zoom;
+        /// The selected zoom center frequency, in Hz
+        double _zoomCenterHz;
+        /// The zoom factor of the spectrum being displayed
+        int _spectrumZoom;
+        /// The zoom center of the spectrum being displayed, in Hz
+        double _spectrumCenterHz;
+        /// The pre-filter
+        PreFilterSpec _preFilter;
+        /// The pre-filters offered by the filter selector
+        std::vector<PreFilterSpec> _filterChoices;
+        /// The one gate trigger
+        TriggerSpec _trigger;
+        /// Set true to pause on the first triggered block
+        bool _singleShot;
+        /// The second channel for the dual channel plots
+        int _pairChannel;
+        /// The scalar dual channel products, for the plot label
+        QString _crossSummary;
+        /// The gate statistics summary, for the plot label
+        QString _statsSummary;
+        /// The target detection along the beam
+        CfarSpec _cfar;
+        /// The targets in the last beam displayed
+        CfarDetections _detections;
+        /// The detected targets, for the plot label
+        QString _cfarSummary;
+        /// The gates of interest along the beam, as last
+        /// reported by the engine
+        GateWindow _gateWindow;
         /// The button group for channel selection
         QButtonGroup* _chanButtonGroup;
         /// Palette for making the leds green
@@ -384,11 +695,15 @@ class AScope : public QWidget, private Ui::AScope {
         /// The signal power, computed directly from the I&Q
         /// data, or from the power spectrum
         double _zeroMoment;
+        /// The moments of the displayed power spectrum, in Hz
+        SpectralMoments _moments;
+        /// Set true to rescale the spectrum to every frame
+        bool _continuousAutoscale;
         /// The choice of channels (0-3)
         int _channel;
         /// The selected gate, zero based.
         int _gateChoice;
-        /// Set false to cause initialization of blocksize and 
+        /// Set false to cause initialization of the
         /// gate choices when the first data is received.
         bool _combosInitialized;
         /// Set true if data are to be taken along the beam. Otherwise
@@ -404,21 +719,56 @@ class AScope : public QWidget, private Ui::AScope {
         double _xyGraphCenter;
         double _specGraphRange;
         double _specGraphCenter;
-        // storage to collect incoming I values
-    	std::vector<double> _I;
-        // storage to collect incoming Q values
-    	std::vector<double> _Q;
-    	// the next index of the incoming location to fill in _I and _Q
-    	unsigned int _nextIQ;
     	/// The number of gates. Initially zero, it is diagnosed from the data stream
     	int _gates;
-        /// set true when we want to start capturing the next incoming data
-        bool _capture;
         /// The directory where images are saved.
         std::string _saveDir;
+        /// The thread pool used for encoding and writing images.
+        QThreadPool _imagePool;
+        /// The number of image writes that have not yet completed.
+        QAtomicInt _imagesInFlight;
+        /// The timer for automatic snapshots.
+        QTimer* _snapshotTimer;
         /// The sample rate in Hz.
         double _sampleRateHz;
+        /// Set true when the background initialization is finished.
+        bool _ready;
+        /// The processing engine
+        AScopeEngine* _engine;
+        /// Our subscriber id with the engine
+        int _subscriberId;
+        /// The item count of the engine at the last timer tick,
+        /// used to drive the activity bar.
+        long long _lastItemCount;
 };
 
 
+////////////////////////////////////////////////////////////////////////
+inline double AScope::TimeSeries::i(int pulse, int gate) const {
+    switch (dataType) {
+        case FLOATDATA:
+            return(static_cast<float*>(IQbeams[pulse])[2 * gate]);
+        case SHORTDATA:
+            return(static_cast<short*>(IQbeams[pulse])[2 * gate]);
+        default:
+            std::cerr << "Attempt to extract data from " <<
+                "AScope::TimeSeries with data type unset!" << std::endl;
+            abort();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+inline double AScope::TimeSeries::q(int pulse, int gate) const {
+    switch (dataType) {
+      case FLOATDATA:
+        return(static_cast<float*>(IQbeams[pulse])[2 * gate + 1]);
+      case SHORTDATA:
+        return(static_cast<short*>(IQbeams[pulse])[2 * gate + 1]);
+      default:
+        std::cerr << "Attempt to extract data from " <<
+        "AScope::TimeSeries with data type unset!" << std::endl;
+        abort();
+    }
+}
+
 #endif /*PROFSCOPE_H_*/
@@ -0,0 +1,1671 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "AScopeEngine.h"
+#include "DspKernels.h"
+
+#include <QMutexLocker>
+#include <QtConcurrentRun>
+#include <set>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+namespace {
+	/// @return A monotonic time, in seconds.
+	double now() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + 1.0e-9*ts.tv_nsec;
+	}
+
+	/// @return A frequency folded into the band [-rate/2, rate/2),
+	/// where a frequency outside it aliases to.
+	/// @param hz The frequency.
+	/// @param rate The sample rate.
+	double foldFrequency(double hz, double rate) {
+		if (rate <= 0.0) {
+			return hz;
+		}
+		double f = fmod(hz + rate/2.0, rate);
+		if (f < 0.0) {
+			f += rate;
+		}
+		return f - rate/2.0;
+	}
+
+	/// Report an item whose data type was never set, as
+	/// AScope::TimeSeries::i() does.
+	void badDataType() {
+		std::cerr << "Attempt to extract data from " <<
+			"AScope::TimeSeries with data type unset!" << std::endl;
+		abort();
+	}
+
+	/// Copy one gate of every pulse of an item.
+	/// @param pItem The item.
+	/// @param gate The gate.
+	/// @param I The I values are returned here; room for every pulse.
+	/// @param Q The Q values are returned here; room for every pulse.
+	void gatherGate(const AScope::TimeSeries& pItem, int gate, double* I, double* Q) {
+		int n = pItem.IQbeams.size();
+		if (n == 0) {
+			return;
+		}
+		const DspKernels& kernels = DspKernels::get();
+		switch (pItem.dataType) {
+		case AScope::TimeSeries::FLOATDATA:
+			kernels.gatherFloat(&pItem.IQbeams[0], n, gate, I, Q);
+			break;
+		case AScope::TimeSeries::SHORTDATA:
+			kernels.gatherShort(&pItem.IQbeams[0], n, gate, I, Q);
+			break;
+		default:
+			badDataType();
+		}
+	}
+
+	/// Copy every stride'th I,Q pair of interleaved data.
+	/// @param iq The first pair.
+	/// @param n The number of pairs to copy.
+	/// @param stride The spacing of the pairs.
+	/// @param I The I values are returned here.
+	/// @param Q The Q values are returned here.
+	template <typename T>
+	void deinterleaveStrided(const T* iq, int n, int stride, double* I, double* Q) {
+		for (int g = 0; g < n; g++) {
+			I[g] = iq[2*g*stride];
+			Q[g] = iq[2*g*stride+1];
+		}
+	}
+
+	/// Copy the gates in a window of one pulse of an item.
+	/// @param pItem The item.
+	/// @param pulse The pulse.
+	/// @param window The gates to copy.
+	/// @param I The I values are returned here; room for window.count() gates.
+	/// @param Q The Q values are returned here; room for window.count() gates.
+	void gatherPulse(const AScope::TimeSeries& pItem, int pulse, const GateWindow& window,
+			double* I, double* Q) {
+		const DspKernels& kernels = DspKernels::get();
+		int n = window.count(pItem.gates);
+		if (n == 0) {
+			return;
+		}
+		switch (pItem.dataType) {
+		case AScope::TimeSeries::FLOATDATA: {
+			const float* iq = static_cast<const float*>(pItem.IQbeams[pulse]) + 2*window.start;
+			if (window.stride == 1) {
+				kernels.deinterleaveFloat(iq, n, I, Q);
+			} else {
+				deinterleaveStrided(iq, n, window.stride, I, Q);
+			}
+			break;
+		}
+		case AScope::TimeSeries::SHORTDATA: {
+			const short* iq = static_cast<const short*>(pItem.IQbeams[pulse]) + 2*window.start;
+			if (window.stride == 1) {
+				kernels.deinterleaveShort(iq, n, I, Q);
+			} else {
+				deinterleaveStrided(iq, n, window.stride, I, Q);
+			}
+			break;
+		}
+		default:
+			badDataType();
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+AScopeEngine::Selection::Selection():
+channel(0),
+gate(0),
+alongBeam(false),
+blockSize(256),
+window(false),
+spectrum(false),
+zoom(1),
+zoomCenterHz(0.0),
+pairChannel(-1),
+crossSegments(8),
+profiles(false)
+{
+}
+
+////////////////////////////////////////////////////////
+int
+AScopeEngine::Selection::effectivePair() const
+{
+	if (alongBeam || pairChannel < 0 || pairChannel == channel) {
+		return -1;
+	}
+	return pairChannel;
+}
+
+////////////////////////////////////////////////////////
+PreFilterSpec
+AScopeEngine::Selection::effectivePreFilter() const
+{
+	// the filters work along time; across range gates they
+	// mean nothing, and would distort the profile
+	return alongBeam ? PreFilterSpec() : preFilter;
+}
+
+////////////////////////////////////////////////////////
+TriggerSpec
+AScopeEngine::Selection::effectiveTrigger() const
+{
+	return (alongBeam || effectivePair() >= 0) ? TriggerSpec() : trigger;
+}
+
+////////////////////////////////////////////////////////
+CfarSpec
+AScopeEngine::Selection::effectiveCfar() const
+{
+	return alongBeam ? cfar : CfarSpec();
+}
+
+////////////////////////////////////////////////////////
+AScopeEngine::WorkerConfig::WorkerConfig():
+workers(0),
+priority(QThread::InheritPriority),
+realtimePriority(0)
+{
+}
+
+////////////////////////////////////////////////////////
+AScopeEngine::WorkerConfig
+AScopeEngine::WorkerConfig::fromEnvironment()
+{
+	WorkerConfig config;
+	const char* s;
+	if ((s = getenv("ASCOPE_WORKERS"))) {
+		config.workers = atoi(s);
+	}
+	if ((s = getenv("ASCOPE_CPUS"))) {
+		config.cpus = parseCpuList(s);
+	}
+	if ((s = getenv("ASCOPE_PRIORITY"))) {
+		int p = atoi(s);
+		if (p >= QThread::IdlePriority && p <= QThread::InheritPriority) {
+			config.priority = QThread::Priority(p);
+		}
+	}
+	if ((s = getenv("ASCOPE_RT_PRIORITY"))) {
+		config.realtimePriority = atoi(s);
+	}
+	return config;
+}
+
+////////////////////////////////////////////////////////
+std::vector<int>
+AScopeEngine::WorkerConfig::parseCpuList(const std::string& list)
+{
+	std::vector<int> cpus;
+	std::istringstream in(list);
+	std::string item;
+	while (std::getline(in, item, ',')) {
+		int first;
+		int last;
+		char dash;
+		std::istringstream range(item);
+		if (!(range >> first)) {
+			continue;
+		}
+		last = first;
+		if (range >> dash && dash == '-') {
+			range >> last;
+		}
+		for (int c = first; c <= last; c++) {
+			cpus.push_back(c);
+		}
+	}
+	return cpus;
+}
+
+////////////////////////////////////////////////////////
+AScopeEngine::GatherKey::GatherKey(const Selection& s):
+channel(s.channel),
+gate(s.alongBeam ? 0 : s.gate),
+alongBeam(s.alongBeam),
+length(0),
+trigger(s.effectiveTrigger()),
+profiles(s.alongBeam && s.profiles),
+pairChannel(s.effectivePair())
+{
+	// Along the beam, the gate and block size do not affect
+	// what is gathered, so they are left out of the key.
+	if (!alongBeam) {
+		length = s.blockSize;
+		if (s.effectiveZoom() > 1) {
+			length = s.blockSize*s.zoom + SpectrumCalc::zoomTaps(s.zoom) - 1;
+		}
+		if (pairChannel >= 0 && s.crossSegments > 1) {
+			length = s.blockSize*s.crossSegments;
+		}
+		int decimation = s.effectivePreFilter().decimation;
+		if (decimation > 1) {
+			length = length*decimation;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+bool
+AScopeEngine::GatherKey::operator<(const GatherKey& o) const
+{
+	if (channel != o.channel)
+		return channel < o.channel;
+	if (alongBeam != o.alongBeam)
+		return alongBeam < o.alongBeam;
+	if (gate != o.gate)
+		return gate < o.gate;
+	if (length != o.length)
+		return length < o.length;
+	if (profiles != o.profiles)
+		return profiles < o.profiles;
+	if (pairChannel != o.pairChannel)
+		return pairChannel < o.pairChannel;
+	return trigger < o.trigger;
+}
+
+////////////////////////////////////////////////////////
+int
+AScopeEngine::GatherKey::preSamples() const
+{
+	// at least the trigger sample itself comes after
+	int pre = trigger.preSamples;
+	if (pre > length - 1)
+		pre = length - 1;
+	if (pre < 0)
+		pre = 0;
+	return pre;
+}
+
+////////////////////////////////////////////////////////
+AScopeEngine::FrameKey::FrameKey(const Selection& s):
+blockSize(s.blockSize),
+window(s.window),
+zoom(s.effectiveZoom()),
+zoomCenterHz(zoom > 1 ? s.zoomCenterHz : 0.0),
+preFilter(s.effectivePreFilter()),
+cfar(s.effectiveCfar())
+{
+}
+
+////////////////////////////////////////////////////////
+bool
+AScopeEngine::FrameKey::operator<(const FrameKey& o) const
+{
+	if (blockSize != o.blockSize)
+		return blockSize < o.blockSize;
+	if (window != o.window)
+		return window < o.window;
+	if (zoom != o.zoom)
+		return zoom < o.zoom;
+	if (zoomCenterHz != o.zoomCenterHz)
+		return zoomCenterHz < o.zoomCenterHz;
+	if (!(preFilter == o.preFilter))
+		return preFilter < o.preFilter;
+	return cfar < o.cfar;
+}
+
+////////////////////////////////////////////////////////
+AScopeEngine::Shard::Shard():
+planChanged(false),
+gateStatsEnabled(false),
+gates(0),
+sampleRateHz(10.0e6)
+{
+}
+
+////////////////////////////////////////////////////////
+AScopeEngine::Shard::~Shard()
+{
+	std::map<int, SpectrumCalc*>::iterator i;
+	for (i = calcs.begin(); i != calcs.end(); i++) {
+		delete i->second;
+	}
+	std::map<RingKey, GateRing*>::iterator r;
+	for (r = rings.begin(); r != rings.end(); r++) {
+		delete r->second;
+	}
+	std::map<GatherKey, Capture*>::iterator c;
+	for (c = captures.begin(); c != captures.end(); c++) {
+		delete c->second;
+	}
+	std::map<PreFilterSpec, PreFilterChain*>::iterator p;
+	for (p = chains.begin(); p != chains.end(); p++) {
+		delete p->second;
+	}
+	std::map<CfarSpec, CfarDetector*>::iterator d;
+	for (d = cfars.begin(); d != cfars.end(); d++) {
+		delete d->second;
+	}
+	std::map<int, Profiles*>::iterator b;
+	for (b = profiles.begin(); b != profiles.end(); b++) {
+		delete b->second;
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::Profiles::push(const AScope::TimeSeries& pItem, const GateWindow& w)
+{
+	int n = w.count(pItem.gates);
+	if (n <= 0) {
+		return;
+	}
+	if (n != gates || w != window) {
+		gates = n;
+		window = w;
+		data.assign((size_t)maxProfiles*gates, 0.0f);
+		first = total;
+	}
+	if (pItem.IQbeams.empty()) {
+		return;
+	}
+	I.resize(gates);
+	Q.resize(gates);
+	gatherPulse(pItem, 0, window, &I[0], &Q[0]);
+	float* row = &data[(size_t)(total % maxProfiles)*gates];
+	for (int g = 0; g < gates; g++) {
+		// keep silent gates finite
+		row[g] = 10.0*log10(I[g]*I[g] + Q[g]*Q[g] + 1.0e-20);
+	}
+	total++;
+}
+
+////////////////////////////////////////////////////////
+SpectrumCalc&
+AScopeEngine::Shard::spectrumCalc(int blockSize)
+{
+	SpectrumCalc*& calc = calcs[blockSize];
+	if (!calc) {
+		calc = new SpectrumCalc(blockSize);
+	}
+	return *calc;
+}
+
+////////////////////////////////////////////////////////
+PreFilterChain&
+AScopeEngine::Shard::preFilterChain(const PreFilterSpec& spec)
+{
+	PreFilterChain*& chain = chains[spec];
+	if (!chain) {
+		chain = new PreFilterChain(spec);
+	}
+	return *chain;
+}
+
+////////////////////////////////////////////////////////
+CfarDetector&
+AScopeEngine::Shard::cfarDetector(const CfarSpec& spec)
+{
+	CfarDetector*& detector = cfars[spec];
+	if (!detector) {
+		detector = new CfarDetector(spec);
+	}
+	return *detector;
+}
+
+////////////////////////////////////////////////////////
+AScopeEngine::AScopeEngine(QObject* parent, const WorkerConfig& config):
+QObject(parent),
+_nextId(0),
+_config(config),
+_gates(0),
+_itemCount(0),
+_ready(false)
+{
+	qRegisterMetaType<ScopeFramePtr>("ScopeFramePtr");
+	qRegisterMetaType<AScope::TimeSeries>("AScope::TimeSeries");
+	qRegisterMetaType<AScope::TimeSeriesBatch>("AScope::TimeSeriesBatch");
+	qRegisterMetaType<CfarDetections>("CfarDetections");
+	qRegisterMetaType<GateWindow>("GateWindow");
+
+	// One shard per worker, or one processed in the caller's thread.
+	int nShards = _config.workers > 0 ? _config.workers : 1;
+	for (int i = 0; i < nShards; i++) {
+		_shards.push_back(new Shard);
+		// Without workers, the pass over every gate of every pulse
+		// would run in the thread that delivers the data, which for
+		// a scope is the gui thread; the host has to ask for it.
+		_shards[i]->gateStatsEnabled = _config.workers > 0;
+	}
+
+	for (int i = 0; i < _config.workers; i++) {
+		QThread* thread = new QThread;
+		AScopeEngineWorker* worker = new AScopeEngineWorker(*this, i);
+		worker->moveToThread(thread);
+		connect(thread, SIGNAL(started()), worker, SLOT(startSlot()));
+		_threads.push_back(thread);
+		_workers.push_back(worker);
+		thread->start(_config.priority);
+	}
+
+	// Build the fftw plans and hamming coefficients for all of
+	// the block size choices in the background, starting with the
+	// initial selection, so that the first spectrum gets a measured
+	// plan without waiting for the others.
+	int initial = Selection().blockSize;
+	std::vector<int> choices = blockSizeChoices();
+	std::vector<int> sizes(1, initial);
+	for (unsigned int i = 0; i < choices.size(); i++) {
+		if (choices[i] != initial) {
+			sizes.push_back(choices[i]);
+		}
+	}
+	connect(&_fftPrepWatcher, SIGNAL(finished()), this, SLOT(fftPreparedSlot()));
+	_fftPrepWatcher.setFuture(
+			QtConcurrent::run(&SpectrumCalc::prepare, sizes,
+					(unsigned int)FFTW_MEASURE));
+}
+
+////////////////////////////////////////////////////////
+AScopeEngine::~AScopeEngine()
+{
+	// let the workers finish what is queued, then stop them
+	for (unsigned int i = 0; i < _workers.size(); i++) {
+		QMetaObject::invokeMethod(_workers[i], "stopSlot", Qt::QueuedConnection);
+	}
+	for (unsigned int i = 0; i < _threads.size(); i++) {
+		_threads[i]->wait();
+		delete _workers[i];
+		delete _threads[i];
+	}
+
+	// nothing more will be made for the outstanding one shot requests
+	std::map<int, Subscriber>::iterator s;
+	for (s = _subscribers.begin(); s != _subscribers.end(); s++) {
+		if (s->second.oneShot) {
+			s->second.promise.reportCanceled();
+			s->second.promise.reportFinished();
+		}
+	}
+
+	_fftPrepWatcher.waitForFinished();
+
+	for (unsigned int i = 0; i < _shards.size(); i++) {
+		delete _shards[i];
+	}
+}
+
+////////////////////////////////////////////////////////
+std::vector<int>
+AScopeEngine::blockSizeChoices()
+{
+	/// @todo allow the max (and min?) block sizes to
+	/// be confiurable.
+	std::vector<int> choices;
+	for (int fftSize = 8; fftSize <= 4096; fftSize = fftSize*2) {
+		choices.push_back(fftSize);
+	}
+	return choices;
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::fftPreparedSlot()
+{
+	_ready = true;
+	emit ready();
+}
+
+////////////////////////////////////////////////////////
+bool
+AScopeEngine::isReady() const
+{
+	return _ready;
+}
+
+////////////////////////////////////////////////////////
+long long
+AScopeEngine::itemCount() const
+{
+	QMutexLocker locker(&_subscriberMutex);
+	return _itemCount;
+}
+
+////////////////////////////////////////////////////////
+int
+AScopeEngine::gates() const
+{
+	QMutexLocker locker(&_subscriberMutex);
+	return _gates;
+}
+
+////////////////////////////////////////////////////////
+GateStats
+AScopeEngine::gateStats(int channel) const
+{
+	const Shard& shard = *_shards[shardIndex(channel)];
+	QMutexLocker locker(&shard.mutex);
+	std::map<int, GateStats>::const_iterator s = shard.gateStats.find(channel);
+	return s != shard.gateStats.end() ? s->second : GateStats();
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::resetGateStats(int channel)
+{
+	for (unsigned int i = 0; i < _shards.size(); i++) {
+		Shard& shard = *_shards[i];
+		QMutexLocker locker(&shard.mutex);
+		if (channel < 0) {
+			shard.gateStats.clear();
+		} else {
+			shard.gateStats.erase(channel);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::setGateStatsEnabled(bool enabled)
+{
+	for (unsigned int i = 0; i < _shards.size(); i++) {
+		Shard& shard = *_shards[i];
+		QMutexLocker locker(&shard.mutex);
+		shard.gateStatsEnabled = enabled;
+	}
+}
+
+////////////////////////////////////////////////////////
+bool
+AScopeEngine::gateStatsEnabled() const
+{
+	const Shard& shard = *_shards[0];
+	QMutexLocker locker(&shard.mutex);
+	return shard.gateStatsEnabled;
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::setGateWindow(const GateWindow& window)
+{
+	bool changed = false;
+	for (unsigned int i = 0; i < _shards.size(); i++) {
+		Shard& shard = *_shards[i];
+		QMutexLocker locker(&shard.mutex);
+		if (window == shard.gateWindow) {
+			continue;
+		}
+		shard.gateWindow = window;
+		// the statistics of other gates do not belong with the new
+		// ones; the profiles start over on their next push
+		shard.gateStats.clear();
+		changed = true;
+	}
+	// every view of the engine follows the window
+	if (changed) {
+		emit gateWindowChanged(window);
+	}
+}
+
+////////////////////////////////////////////////////////
+GateWindow
+AScopeEngine::gateWindow() const
+{
+	const Shard& shard = *_shards[0];
+	QMutexLocker locker(&shard.mutex);
+	return shard.gateWindow;
+}
+
+////////////////////////////////////////////////////////
+int
+AScopeEngine::shardIndex(int channel) const
+{
+	int n = _shards.size();
+	int i = channel % n;
+	return i < 0 ? i + n : i;
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::configureThread(int index)
+{
+#ifdef __linux__
+	pthread_t self = pthread_self();
+
+	if (!_config.cpus.empty()) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if ((int)_config.cpus.size() >= _config.workers) {
+			CPU_SET(_config.cpus[index], &set);
+		} else {
+			for (unsigned int i = 0; i < _config.cpus.size(); i++) {
+				CPU_SET(_config.cpus[i], &set);
+			}
+		}
+		int status = pthread_setaffinity_np(self, sizeof(set), &set);
+		if (status) {
+			std::cerr << "AScopeEngine: unable to set the affinity of worker "
+					<< index << ": " << strerror(status) << std::endl;
+		}
+	}
+
+	if (_config.realtimePriority > 0) {
+		struct sched_param param;
+		param.sched_priority = _config.realtimePriority;
+		int status = pthread_setschedparam(self, SCHED_FIFO, &param);
+		if (status) {
+			std::cerr << "AScopeEngine: unable to set realtime priority "
+					<< _config.realtimePriority << " for worker " << index
+					<< ": " << strerror(status) << std::endl;
+		}
+	}
+#else
+	if (!_config.cpus.empty() || _config.realtimePriority > 0) {
+		std::cerr << "AScopeEngine: worker affinity and realtime "
+				"priority are not supported on this platform" << std::endl;
+	}
+#endif
+}
+
+////////////////////////////////////////////////////////
+int
+AScopeEngine::subscribe(const Selection& selection)
+{
+	int id;
+	{
+		QMutexLocker locker(&_subscriberMutex);
+		id = _nextId++;
+		_subscribers[id].selection = selection;
+	}
+	updateRings();
+	return id;
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::setSelection(int id, const Selection& selection)
+{
+	{
+		QMutexLocker locker(&_subscriberMutex);
+
+		std::map<int, Subscriber>::iterator s = _subscribers.find(id);
+		if (s == _subscribers.end()) {
+			return;
+		}
+		// profiles from another gather mean nothing to this one
+		GatherKey before(s->second.selection);
+		GatherKey after(selection);
+		if (before < after || after < before) {
+			s->second.nextProfile = -1;
+		}
+		s->second.selection = selection;
+	}
+	updateRings();
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::unsubscribe(int id)
+{
+	{
+		QMutexLocker locker(&_subscriberMutex);
+		_subscribers.erase(id);
+	}
+	updateRings();
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::requestFrame(int id)
+{
+	int channel;
+	{
+		QMutexLocker locker(&_subscriberMutex);
+
+		std::map<int, Subscriber>::iterator s = _subscribers.find(id);
+		if (s == _subscribers.end()) {
+			return;
+		}
+		s->second.pending = true;
+		if (s->second.selection.alongBeam) {
+			return;
+		}
+		channel = s->second.selection.channel;
+	}
+
+	// serve it now if the samples are already buffered
+	int index = shardIndex(channel);
+	if (_workers.empty()) {
+		serveShard(index);
+	} else {
+		QMetaObject::invokeMethod(_workers[index], "serveSlot", Qt::QueuedConnection);
+	}
+}
+
+////////////////////////////////////////////////////////
+QFuture<ScopeFramePtr>
+AScopeEngine::requestOnce(const Selection& selection)
+{
+	QFuture<ScopeFramePtr> future;
+	int id;
+	{
+		QMutexLocker locker(&_subscriberMutex);
+
+		// drop the requests that their callers have given up on
+		std::map<int, Subscriber>::iterator s = _subscribers.begin();
+		while (s != _subscribers.end()) {
+			if (s->second.oneShot && s->second.promise.isCanceled()) {
+				s->second.promise.reportFinished();
+				_subscribers.erase(s++);
+			} else {
+				s++;
+			}
+		}
+
+		id = _nextId++;
+		Subscriber& sub = _subscribers[id];
+		sub.selection = selection;
+		sub.oneShot = true;
+		sub.promise.reportStarted();
+		future = sub.promise.future();
+	}
+	updateRings();
+	requestFrame(id);
+	return future;
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::updateRings()
+{
+	QMutexLocker planLocker(&_planMutex);
+
+	// the capacity needed for each selected gate, and the triggers
+	std::vector<std::map<RingKey, int> > needed(_shards.size());
+	std::vector<std::set<GatherKey> > triggered(_shards.size());
+	std::vector<std::set<int> > profiled(_shards.size());
+	{
+		QMutexLocker locker(&_subscriberMutex);
+		std::map<int, Subscriber>::iterator s;
+		for (s = _subscribers.begin(); s != _subscribers.end(); s++) {
+			GatherKey key(s->second.selection);
+			int index = shardIndex(key.channel);
+			if (key.profiles) {
+				profiled[index].insert(key.channel);
+			}
+			if (key.alongBeam) {
+				continue;
+			}
+			int& n = needed[index][RingKey(key.channel, key.gate)];
+			if (key.length > n) {
+				n = key.length;
+			}
+			// a two channel gather needs the gate on both channels
+			if (key.pairChannel >= 0) {
+				int& p = needed[shardIndex(key.pairChannel)][RingKey(key.pairChannel, key.gate)];
+				if (key.length > p) {
+					p = key.length;
+				}
+			}
+			if (key.trigger.enabled()) {
+				triggered[index].insert(key);
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < _shards.size(); i++) {
+		Shard& shard = *_shards[i];
+		QMutexLocker locker(&shard.mutex);
+		shard.ringPlan = needed[i];
+		shard.capturePlan = triggered[i];
+		shard.profilePlan = profiled[i];
+		shard.planChanged = true;
+		// Without workers, there is no thread to prefer; apply it
+		// now so that a new selection can be served right away.
+		if (_workers.empty()) {
+			applyPlan(shard);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::applyPlan(Shard& shard)
+{
+	if (!shard.planChanged) {
+		return;
+	}
+	shard.planChanged = false;
+
+	// Captures are kept while selected, pending or not, so
+	// that the triggers see an unbroken signal history.
+	std::map<GatherKey, Capture*>::iterator c = shard.captures.begin();
+	while (c != shard.captures.end()) {
+		if (shard.capturePlan.find(c->first) == shard.capturePlan.end()) {
+			delete c->second;
+			shard.captures.erase(c++);
+		} else {
+			c++;
+		}
+	}
+	std::set<GatherKey>::iterator t;
+	for (t = shard.capturePlan.begin(); t != shard.capturePlan.end(); t++) {
+		Capture*& capture = shard.captures[*t];
+		if (!capture) {
+			capture = new Capture(t->trigger);
+		}
+	}
+
+	std::map<int, Profiles*>::iterator b = shard.profiles.begin();
+	while (b != shard.profiles.end()) {
+		if (shard.profilePlan.find(b->first) == shard.profilePlan.end()) {
+			delete b->second;
+			shard.profiles.erase(b++);
+		} else {
+			b++;
+		}
+	}
+	std::set<int>::iterator ch;
+	for (ch = shard.profilePlan.begin(); ch != shard.profilePlan.end(); ch++) {
+		Profiles*& profiles = shard.profiles[*ch];
+		if (!profiles) {
+			profiles = new Profiles;
+		}
+	}
+
+	// remove the rings that are no longer selected
+	std::map<RingKey, GateRing*>::iterator r = shard.rings.begin();
+	while (r != shard.rings.end()) {
+		if (shard.ringPlan.find(r->first) == shard.ringPlan.end()) {
+			delete r->second;
+			shard.rings.erase(r++);
+		} else {
+			r++;
+		}
+	}
+
+	// create or resize the others, keeping their samples
+	std::map<RingKey, int>::iterator n;
+	for (n = shard.ringPlan.begin(); n != shard.ringPlan.end(); n++) {
+		GateRing*& ring = shard.rings[n->first];
+		if (!ring) {
+			ring = new GateRing(n->second);
+		} else {
+			ring->setCapacity(n->second);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::serveShard(int index)
+{
+	std::vector<Delivery> deliveries;
+	{
+		Shard& shard = *_shards[index];
+		QMutexLocker locker(&shard.mutex);
+		serveRings(shard, index, deliveries);
+	}
+	servePairs(index, deliveries);
+	deliver(deliveries);
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::serveRings(Shard& shard, int index, std::vector<Delivery>& deliveries)
+{
+	// triggered gathers are served by ingest(), and
+	// two channel gathers by servePairs(), instead
+	std::set<GatherKey> wanted;
+	{
+		QMutexLocker locker(&_subscriberMutex);
+		std::map<int, Subscriber>::iterator s;
+		for (s = _subscribers.begin(); s != _subscribers.end(); s++) {
+			const Selection& sel = s->second.selection;
+			if (s->second.pending && !sel.alongBeam && !sel.effectiveTrigger().enabled() &&
+					sel.effectivePair() < 0 && shardIndex(sel.channel) == index) {
+				wanted.insert(GatherKey(sel));
+			}
+		}
+	}
+
+	Group group;
+	std::set<GatherKey>::iterator k;
+	for (k = wanted.begin(); k != wanted.end(); k++) {
+		std::map<RingKey, GateRing*>::iterator r =
+				shard.rings.find(RingKey(k->channel, k->gate));
+		if (r == shard.rings.end()) {
+			continue;
+		}
+		if (r->second->latest(k->length, group.I, group.Q)) {
+			process(shard, *k, group, deliveries);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::servePairs(int index, std::vector<Delivery>& deliveries)
+{
+	std::set<GatherKey> wanted;
+	{
+		QMutexLocker locker(&_subscriberMutex);
+		std::map<int, Subscriber>::iterator s;
+		for (s = _subscribers.begin(); s != _subscribers.end(); s++) {
+			const Selection& sel = s->second.selection;
+			int pair = sel.effectivePair();
+			if (s->second.pending && pair >= 0 &&
+					(shardIndex(sel.channel) == index || shardIndex(pair) == index)) {
+				wanted.insert(GatherKey(sel));
+			}
+		}
+	}
+
+	Group first;
+	Group second;
+	std::set<GatherKey>::iterator k;
+	for (k = wanted.begin(); k != wanted.end(); k++) {
+		SamplesEnd end1;
+		SamplesEnd end2;
+		if (!latestSamples(k->channel, k->gate, k->length, first, end1) ||
+				!latestSamples(k->pairChannel, k->gate, k->length, second, end2)) {
+			continue;
+		}
+		// Wait until the other channel has caught up. Either
+		// channel's thread may get here first.
+		if (!pairAligned(*k, end1, end2)) {
+			continue;
+		}
+		Shard& shard = *_shards[index];
+		QMutexLocker locker(&shard.mutex);
+		processPair(shard, *k, first, second, deliveries);
+	}
+}
+
+////////////////////////////////////////////////////////
+bool
+AScopeEngine::latestSamples(int channel, int gate, int length, Group& group, SamplesEnd& end)
+{
+	Shard& shard = *_shards[shardIndex(channel)];
+	QMutexLocker locker(&shard.mutex);
+
+	std::map<RingKey, GateRing*>::iterator r = shard.rings.find(RingKey(channel, gate));
+	if (r == shard.rings.end()) {
+		return false;
+	}
+	end.pulses = shard.pulses[channel];
+	end.timestamp = shard.timestamps[channel];
+	end.sampleRateHz = shard.sampleRateHz;
+	return r->second->latest(length, group.I, group.Q);
+}
+
+////////////////////////////////////////////////////////
+bool
+AScopeEngine::pairAligned(const GatherKey& key, const SamplesEnd& end1, const SamplesEnd& end2)
+{
+	// the producer says when the pulses were taken
+	if (end1.timestamp > 0.0 && end2.timestamp > 0.0) {
+		double tolerance = end1.sampleRateHz > 0.0 ? 0.5/end1.sampleRateHz : 0.0;
+		return fabs(end1.timestamp - end2.timestamp) <= tolerance;
+	}
+
+	// otherwise pair by count
+	QMutexLocker locker(&_subscriberMutex);
+	PairAlignment& a = _pairAlignments[key];
+	long long diff = end1.pulses - end2.pulses;
+	if (diff == a.offset) {
+		a.since1 = -1;
+		return true;
+	}
+	if (a.since1 < 0) {
+		a.closest = diff;
+		a.since1 = end1.pulses;
+		a.since2 = end2.pulses;
+		return false;
+	}
+	if ((diff < 0 ? -diff : diff) < (a.closest < 0 ? -a.closest : a.closest)) {
+		a.closest = diff;
+	}
+	// One channel running ahead of the other comes back to the
+	// offset soon. If both channels move on by a whole gather
+	// without that, a pulse was dropped or added on one of them,
+	// and the counts will not come back together.
+	if (end1.pulses - a.since1 >= key.length && end2.pulses - a.since2 >= key.length) {
+		a.offset = a.closest;
+		a.since1 = -1;
+		return diff == a.offset;
+	}
+	return false;
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::deliver(const std::vector<Delivery>& deliveries)
+{
+	bool oneShotsDone = false;
+	for (unsigned int i = 0; i < deliveries.size(); i++) {
+		int id = deliveries[i].first;
+		{
+			QMutexLocker locker(&_subscriberMutex);
+			std::map<int, Subscriber>::iterator s = _subscribers.find(id);
+			if (s != _subscribers.end() && s->second.oneShot) {
+				QFutureInterface<ScopeFramePtr>& promise = s->second.promise;
+				if (!promise.isCanceled()) {
+					promise.reportResult(deliveries[i].second);
+				}
+				promise.reportFinished();
+				_subscribers.erase(s);
+				oneShotsDone = true;
+				continue;
+			}
+		}
+		emit frameReady(id, deliveries[i].second);
+	}
+
+	// the finished one shot requests may have been the
+	// only ones using some of the rings
+	if (oneShotsDone) {
+		updateRings();
+	}
+}
+
+////////////////////////////////////////////////////////
+std::vector<PreFilterChain::StageTiming>
+AScopeEngine::preFilterTiming(const PreFilterSpec& spec) const
+{
+	// add up the timing from all of the shards
+	std::vector<PreFilterChain::StageTiming> timing;
+	for (unsigned int i = 0; i < _shards.size(); i++) {
+		const Shard& shard = *_shards[i];
+		QMutexLocker locker(&shard.mutex);
+
+		std::map<PreFilterSpec, PreFilterChain*>::const_iterator c = shard.chains.find(spec);
+		if (c == shard.chains.end()) {
+			continue;
+		}
+		std::vector<PreFilterChain::StageTiming> t = c->second->timing();
+		if (timing.empty()) {
+			timing = t;
+			continue;
+		}
+		for (unsigned int j = 0; j < t.size() && j < timing.size(); j++) {
+			timing[j].calls += t[j].calls;
+			timing[j].totalSecs += t[j].totalSecs;
+			timing[j].lastSecs = t[j].lastSecs;
+		}
+	}
+	return timing;
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::newTSItemSlot(const AScope::TimeSeries& pItem)
+{
+	{
+		QMutexLocker locker(&_subscriberMutex);
+		_itemCount++;
+	}
+
+	double arrival = now();
+	int index = shardIndex(pItem.chanId);
+	if (_workers.empty()) {
+		ingestItem(index, pItem, arrival);
+	} else {
+		QMetaObject::invokeMethod(_workers[index], "itemSlot", Qt::QueuedConnection,
+				Q_ARG(AScope::TimeSeries, pItem), Q_ARG(double, arrival));
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::newTSBatchSlot(AScope::TimeSeriesBatch batch)
+{
+	double arrival = now();
+	if (batch.size() == 0) {
+		emit returnTSBatch(batch);
+		return;
+	}
+	{
+		QMutexLocker locker(&_subscriberMutex);
+		_itemCount += batch.size();
+	}
+
+	// each shard with items in the batch takes its own; the
+	// count must be set before any of them can finish
+	std::set<int> shards;
+	for (int i = 0; i < batch.size(); i++) {
+		shards.insert(shardIndex(batch[i].chanId));
+	}
+	batch._shared->shards = shards.size();
+
+	std::set<int>::iterator s;
+	for (s = shards.begin(); s != shards.end(); s++) {
+		if (_workers.empty()) {
+			ingestBatch(*s, batch, arrival);
+		} else {
+			QMetaObject::invokeMethod(_workers[*s], "batchSlot", Qt::QueuedConnection,
+					Q_ARG(AScope::TimeSeriesBatch, batch), Q_ARG(double, arrival));
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::ingestItem(int index, const AScope::TimeSeries& pItem, double arrival)
+{
+	std::vector<Delivery> deliveries;
+	int gates = ingestItems(index, &pItem, 1, arrival, deliveries);
+
+	if (gates >= 0) {
+		emit gatesChanged(gates);
+	}
+
+	// The samples have been taken; return the item before
+	// handing out the frames.
+	emit returnTSItem(pItem);
+
+	servePairs(index, deliveries);
+
+	deliver(deliveries);
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::ingestBatch(int index, AScope::TimeSeriesBatch batch, double arrival)
+{
+	std::vector<Delivery> deliveries;
+	int gates = ingestItems(index, batch.data(), batch.size(), arrival, deliveries);
+
+	if (gates >= 0) {
+		emit gatesChanged(gates);
+	}
+
+	// the last shard to finish returns the batch
+	if (!batch._shared->shards.deref()) {
+		emit returnTSBatch(batch);
+	}
+
+	servePairs(index, deliveries);
+
+	deliver(deliveries);
+}
+
+////////////////////////////////////////////////////////
+int
+AScopeEngine::ingestItems(int index, const AScope::TimeSeries* items, int count,
+		double arrival, std::vector<Delivery>& deliveries)
+{
+	int newGates = -1;
+	Shard& shard = *_shards[index];
+	QMutexLocker shardLocker(&shard.mutex);
+
+	applyPlan(shard);
+
+	double ingested = now();
+	for (int n = 0; n < count; n++) {
+		const AScope::TimeSeries& pItem = items[n];
+		if (shardIndex(pItem.chanId) != index) {
+			continue;
+		}
+		bool gatesChanged = false;
+
+		// Samples from before a change in the number
+		// of gates do not belong with the new ones.
+		if (pItem.gates != shard.gates) {
+			shard.gates = pItem.gates;
+			std::map<RingKey, GateRing*>::iterator r;
+			for (r = shard.rings.begin(); r != shard.rings.end(); r++) {
+				r->second->clear();
+			}
+			std::map<GatherKey, Capture*>::iterator c;
+			for (c = shard.captures.begin(); c != shard.captures.end(); c++) {
+				c->second->detector.reset();
+				c->second->triggerAt = -1;
+			}
+		}
+		shard.sampleRateHz = pItem.sampleRateHz;
+		shard.pulses[pItem.chanId] += pItem.IQbeams.size();
+		shard.timestamps[pItem.chanId] = pItem.timestamp;
+		shard.queueSecs[pItem.chanId] = ingested - arrival;
+
+		// every pulse goes into the gate statistics
+		int windowGates = shard.gateWindow.count(pItem.gates);
+		if (shard.gateStatsEnabled && windowGates > 0) {
+			GateStats& stats = shard.gateStats[pItem.chanId];
+			shard.gatherI.resize(windowGates);
+			shard.gatherQ.resize(windowGates);
+			for (unsigned int t = 0; t < pItem.IQbeams.size(); t++) {
+				gatherPulse(pItem, t, shard.gateWindow, &shard.gatherI[0], &shard.gatherQ[0]);
+				stats.push(&shard.gatherI[0], &shard.gatherQ[0], windowGates);
+			}
+		}
+
+		// every beam goes into the profiles, if anyone shows them
+		std::map<int, Profiles*>::iterator b = shard.profiles.find(pItem.chanId);
+		Profiles* profiles = 0;
+		if (b != shard.profiles.end() && pItem.IQbeams.size() > 0) {
+			profiles = b->second;
+			profiles->push(pItem, shard.gateWindow);
+		}
+
+		// the triggered and along beam gathers that someone is waiting for
+		std::set<GatherKey> pending;
+		std::set<GatherKey> beams;
+		// the range-time subscribers that are waiting, with the
+		// first profile each has not seen
+		std::vector<std::pair<int, long long> > profiled;
+		{
+			QMutexLocker locker(&_subscriberMutex);
+			if (pItem.gates != _gates) {
+				_gates = pItem.gates;
+				gatesChanged = true;
+			}
+			std::map<int, Subscriber>::iterator s;
+			for (s = _subscribers.begin(); s != _subscribers.end(); s++) {
+				const Selection& sel = s->second.selection;
+				if (!s->second.pending || sel.channel != pItem.chanId) {
+					continue;
+				}
+				if (sel.alongBeam && sel.profiles) {
+					if (profiles) {
+						profiled.push_back(std::make_pair(s->first, s->second.nextProfile));
+						s->second.nextProfile = profiles->total;
+						s->second.pending = false;
+					}
+				} else if (sel.alongBeam) {
+					beams.insert(GatherKey(sel));
+				} else if (sel.effectiveTrigger().enabled()) {
+					pending.insert(GatherKey(sel));
+				}
+			}
+		}
+
+		// Every pulse goes into the rings for this channel,
+		// whether or not a frame has been asked for.
+		std::map<RingKey, GateRing*>::iterator r;
+		for (r = shard.rings.begin(); r != shard.rings.end(); r++) {
+			int gate = r->first.second;
+			if (r->first.first != pItem.chanId || gate >= pItem.gates) {
+				continue;
+			}
+			ingest(shard, r->first, *r->second, pItem, pending, deliveries);
+		}
+
+		// Along the beam, the frame comes from the first pulse of this item.
+		if (!beams.empty() && windowGates > 0) {
+			Group group;
+			group.I.resize(windowGates);
+			group.Q.resize(windowGates);
+			gatherPulse(pItem, 0, shard.gateWindow, &group.I[0], &group.Q[0]);
+			std::set<GatherKey>::iterator k;
+			for (k = beams.begin(); k != beams.end(); k++) {
+				process(shard, *k, group, deliveries);
+			}
+		}
+
+		for (unsigned int p = 0; p < profiled.size(); p++) {
+			deliveries.push_back(Delivery(profiled[p].first,
+					profileFrame(shard, pItem.chanId, profiled[p].second)));
+		}
+
+		if (gatesChanged) {
+			newGates = pItem.gates;
+		}
+	}
+
+	serveRings(shard, index, deliveries);
+	return newGates;
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::ingest(Shard& shard, const RingKey& key, GateRing& ring,
+		const AScope::TimeSeries& pItem, const std::set<GatherKey>& pending,
+		std::vector<Delivery>& deliveries)
+{
+	int gate = key.second;
+	int tsLength = pItem.IQbeams.size();
+
+	// the captures on this gate
+	std::vector<std::pair<const GatherKey*, Capture*> > captures;
+	std::map<GatherKey, Capture*>::iterator c;
+	for (c = shard.captures.begin(); c != shard.captures.end(); c++) {
+		if (c->first.channel == key.first && c->first.gate == gate) {
+			captures.push_back(std::make_pair(&c->first, c->second));
+		}
+	}
+	if (tsLength == 0) {
+		return;
+	}
+	shard.gatherI.resize(tsLength);
+	shard.gatherQ.resize(tsLength);
+	gatherGate(pItem, gate, &shard.gatherI[0], &shard.gatherQ[0]);
+	if (captures.empty()) {
+		ring.push(&shard.gatherI[0], &shard.gatherQ[0], tsLength);
+		return;
+	}
+
+	Group group;
+	for (int t = 0; t < tsLength; t++) {
+		double i = shard.gatherI[t];
+		double q = shard.gatherQ[t];
+		ring.push(i, q);
+		for (unsigned int k = 0; k < captures.size(); k++) {
+			const GatherKey& gk = *captures[k].first;
+			Capture& capture = *captures[k].second;
+			// keep the detector up to date even while capturing,
+			// so that it rearms on the signal it has really seen
+			bool fired = capture.detector.sample(i, q);
+			if (capture.triggerAt < 0) {
+				if (fired && pending.find(gk) != pending.end()) {
+					capture.triggerAt = ring.total() - 1;
+				}
+				if (capture.triggerAt < 0) {
+					continue;
+				}
+			}
+			// is the post trigger part of the block complete?
+			long long post = gk.length - gk.preSamples();
+			if (ring.total() - capture.triggerAt < post) {
+				continue;
+			}
+			// the pre trigger samples may not have been there
+			// if the trigger came right after a gap
+			if (ring.latest(gk.length, group.I, group.Q)) {
+				process(shard, gk, group, deliveries);
+			}
+			capture.triggerAt = -1;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::process(Shard& shard, const GatherKey& key, Group& group,
+		std::vector<Delivery>& deliveries)
+{
+	// One frame is made for each distinct block size, window and zoom
+	// choice among the waiting subscribers. Along the beam, the block
+	// size only affects the fft length. The waiting subscribers are
+	// collected first, so that the subscriber list is not locked
+	// while the products are computed.
+	std::map<FrameKey, std::vector<int> > members;
+	std::map<FrameKey, bool> spectrum;
+	{
+		QMutexLocker locker(&_subscriberMutex);
+		std::map<int, Subscriber>::iterator s;
+		for (s = _subscribers.begin(); s != _subscribers.end(); s++) {
+			Subscriber& sub = s->second;
+			if (!sub.pending || GatherKey(sub.selection) < key || key < GatherKey(sub.selection)) {
+				continue;
+			}
+			FrameKey pk(sub.selection);
+			members[pk].push_back(s->first);
+			spectrum[pk] = spectrum[pk] || sub.selection.spectrum;
+			sub.pending = false;
+		}
+	}
+
+	std::map<FrameKey, std::vector<int> >::iterator m;
+	for (m = members.begin(); m != members.end(); m++) {
+		const FrameKey& pk = m->first;
+		double start = now();
+		ScopeFrame* frame = new ScopeFrame;
+		frame->channel = key.channel;
+		frame->gate = key.gate;
+		frame->alongBeam = key.alongBeam;
+		frame->gates = shard.gates;
+		frame->sampleRateHz = shard.sampleRateHz;
+		frame->blockSize = pk.blockSize;
+		frame->window = pk.window;
+		frame->zoom = pk.zoom;
+		frame->preFilter = pk.preFilter;
+		if (key.alongBeam) {
+			frame->gateWindow = shard.gateWindow;
+		}
+		if (key.trigger.enabled()) {
+			frame->triggered = true;
+			frame->triggerIndex = key.preSamples()/pk.preFilter.decimation;
+		}
+		frame->I = group.I;
+		frame->Q = group.Q;
+		// condition the time series before anything is computed from it
+		if (!pk.preFilter.empty()) {
+			shard.preFilterChain(pk.preFilter).apply(frame->I, frame->Q);
+			frame->sampleRateHz = shard.sampleRateHz/pk.preFilter.decimation;
+		}
+		// a center outside the band would alias there anyway; say
+		// where it really is, so that the axis is right
+		frame->zoomCenterHz = foldFrequency(pk.zoomCenterHz, frame->sampleRateHz);
+		frame->zeroMoment = SpectrumCalc::zeroMomentFromTimeSeries(
+				&frame->I[0], &frame->Q[0], frame->I.size());
+
+		// look for targets along the beam
+		if (pk.cfar.enabled()) {
+			int n = frame->I.size();
+			std::vector<double> power(n);
+			for (int g = 0; g < n; g++) {
+				power[g] = frame->I[g]*frame->I[g] + frame->Q[g]*frame->Q[g];
+			}
+			frame->cfar = pk.cfar;
+			shard.cfarDetector(pk.cfar).detect(n ? &power[0] : 0, n,
+					frame->detections, frame->cfarThreshold);
+			// report the targets by their gate numbers
+			for (unsigned int d = 0; d < frame->detections.size(); d++) {
+				frame->detections[d].gate = frame->gateWindow.gate(frame->detections[d].gate);
+			}
+		}
+
+		// compute the spectrum once, if anyone needs it
+		if (spectrum[pk]) {
+			SpectrumCalc& calc = shard.spectrumCalc(frame->blockSize);
+			calc.setWindow(frame->window);
+			if (frame->zoom > 1) {
+				frame->spectrumZeroMoment =
+						calc.zoomSpectrum(&frame->I[0], &frame->Q[0], frame->I.size(),
+								frame->zoom, frame->zoomCenterHz/frame->sampleRateHz,
+								frame->spectrum);
+				frame->moments = calc.moments().scaled(
+						frame->sampleRateHz/frame->zoom, frame->zoomCenterHz);
+			} else {
+				frame->spectrumZeroMoment =
+						calc.powerSpectrum(frame->I, frame->Q, frame->spectrum);
+				frame->moments = calc.moments().scaled(frame->sampleRateHz, 0.0);
+			}
+		}
+		finishFrame(shard, frame, start);
+
+		ScopeFramePtr shared(frame);
+		std::vector<int>& ids = m->second;
+		for (unsigned int i = 0; i < ids.size(); i++) {
+			deliveries.push_back(Delivery(ids[i], shared));
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::processPair(Shard& shard, const GatherKey& key, Group& first, Group& second,
+		std::vector<Delivery>& deliveries)
+{
+	// as in process(), claim the waiting subscribers first; the
+	// other channel's thread may have served them already
+	std::map<FrameKey, std::vector<int> > members;
+	{
+		QMutexLocker locker(&_subscriberMutex);
+		std::map<int, Subscriber>::iterator s;
+		for (s = _subscribers.begin(); s != _subscribers.end(); s++) {
+			Subscriber& sub = s->second;
+			if (!sub.pending || GatherKey(sub.selection) < key || key < GatherKey(sub.selection)) {
+				continue;
+			}
+			FrameKey pk(sub.selection);
+			members[pk].push_back(s->first);
+			sub.pending = false;
+		}
+	}
+
+	std::map<FrameKey, std::vector<int> >::iterator m;
+	for (m = members.begin(); m != members.end(); m++) {
+		const FrameKey& pk = m->first;
+		double start = now();
+		ScopeFrame* frame = new ScopeFrame;
+		frame->channel = key.channel;
+		frame->gate = key.gate;
+		frame->pairChannel = key.pairChannel;
+		frame->gates = shard.gates;
+		frame->sampleRateHz = shard.sampleRateHz;
+		frame->blockSize = pk.blockSize;
+		frame->window = pk.window;
+		frame->preFilter = pk.preFilter;
+		frame->I = first.I;
+		frame->Q = first.Q;
+		std::vector<double> I2 = second.I;
+		std::vector<double> Q2 = second.Q;
+		if (!pk.preFilter.empty()) {
+			PreFilterChain& chain = shard.preFilterChain(pk.preFilter);
+			chain.apply(frame->I, frame->Q);
+			chain.apply(I2, Q2);
+			frame->sampleRateHz = shard.sampleRateHz/pk.preFilter.decimation;
+		}
+		frame->zeroMoment = SpectrumCalc::zeroMomentFromTimeSeries(
+				&frame->I[0], &frame->Q[0], frame->I.size());
+
+		// each channel's segments are transformed once, for all
+		// of the products
+		SpectrumCalc& calc = shard.spectrumCalc(frame->blockSize);
+		calc.setWindow(frame->window);
+		int n = std::min(frame->I.size(), I2.size());
+		calc.crossSpectra(&frame->I[0], &frame->Q[0], &I2[0], &Q2[0], n, frame->cross);
+		frame->spectrum = frame->cross.power1;
+		frame->spectrumZeroMoment = frame->cross.zeroMoment1;
+		finishFrame(shard, frame, start);
+
+		ScopeFramePtr shared(frame);
+		std::vector<int>& ids = m->second;
+		for (unsigned int i = 0; i < ids.size(); i++) {
+			deliveries.push_back(Delivery(ids[i], shared));
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+ScopeFramePtr
+AScopeEngine::profileFrame(Shard& shard, int channel, long long from)
+{
+	double start = now();
+	const Profiles& profiles = *shard.profiles[channel];
+
+	long long first = profiles.total - maxProfiles;
+	if (first < profiles.first)
+		first = profiles.first;
+	if (from > first)
+		first = from;
+	if (first > profiles.total)
+		first = profiles.total;
+	int count = profiles.total - first;
+
+	ScopeFrame* frame = new ScopeFrame;
+	frame->channel = channel;
+	frame->alongBeam = true;
+	frame->gates = profiles.gates;
+	frame->gateWindow = profiles.window;
+	frame->sampleRateHz = shard.sampleRateHz;
+	frame->profileCount = count;
+	frame->profiles.resize((size_t)count*profiles.gates);
+	for (int p = 0; p < count; p++) {
+		const float* row = &profiles.data[(size_t)((first + p) % maxProfiles)*profiles.gates];
+		std::copy(row, row + profiles.gates, &frame->profiles[(size_t)p*profiles.gates]);
+	}
+	finishFrame(shard, frame, start);
+	return ScopeFramePtr(frame);
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngine::finishFrame(const Shard& shard, ScopeFrame* frame, double start)
+{
+	// a two channel frame may be made in the second channel's shard,
+	// once that channel has caught up with the first
+	int channel = frame->channel;
+	if (shard.timestamps.find(channel) == shard.timestamps.end()) {
+		channel = frame->pairChannel;
+	}
+	std::map<int, double>::const_iterator t = shard.timestamps.find(channel);
+	if (t != shard.timestamps.end()) {
+		frame->timestamp = t->second;
+		frame->queueSecs = shard.queueSecs.find(channel)->second;
+	}
+	frame->readyTime = now();
+	frame->processingSecs = frame->readyTime - start;
+}
+
+////////////////////////////////////////////////////////
+AScopeEngineWorker::AScopeEngineWorker(AScopeEngine& engine, int index):
+_engine(engine),
+_index(index)
+{
+}
+
+////////////////////////////////////////////////////////
+AScopeEngineWorker::~AScopeEngineWorker()
+{
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngineWorker::startSlot()
+{
+	_engine.configureThread(_index);
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngineWorker::itemSlot(AScope::TimeSeries pItem, double arrival)
+{
+	_engine.ingestItem(_index, pItem, arrival);
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngineWorker::batchSlot(AScope::TimeSeriesBatch batch, double arrival)
+{
+	_engine.ingestBatch(_index, batch, arrival);
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngineWorker::serveSlot()
+{
+	_engine.serveShard(_index);
+}
+
+////////////////////////////////////////////////////////
+void
+AScopeEngineWorker::stopSlot()
+{
+	QThread::currentThread()->quit();
+}
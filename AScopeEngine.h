@@ -0,0 +1,708 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef ASCOPEENGINEINC_
+#define ASCOPEENGINEINC_
+
+#include <QObject>
+#include <QMutex>
+#include <QThread>
+#include <QFutureWatcher>
+#include <QFutureInterface>
+#include <vector>
+#include <map>
+#include <set>
+
+#include "AScope.h"
+#include "ScopeFrame.h"
+#include "SpectrumCalc.h"
+#include "GateRing.h"
+#include "GateStats.h"
+#include "PreFilter.h"
+#include "Trigger.h"
+#include "Cfar.h"
+#include "GateWindow.h"
+
+class AScopeEngineWorker;
+
+/**
+ AScopeEngine is the processing core behind one or more AScope views.
+ It receives the time series from the data provider, gathers the I and Q
+ samples that the views have asked for, computes the products, and
+ hands the results to the views as ScopeFrame objects.
+
+ Each view subscribes with a Selection: the channel, gate or along
+ beam mode, block size, and whether it needs a power spectrum. A view
+ asks for its next frame with requestFrame(), typically on its display
+ timer. In fixed gate mode, every pulse for each selected gate is
+ pushed into a GateRing, whether or not a frame has been requested, so
+ the latest samples are always on hand: a request is served as soon as
+ the ring holds enough samples, usually immediately, and successive
+ frames overlap if the display asks faster than the data arrive.
+ A fixed gate selection may instead carry a TriggerSpec. The trigger
+ is evaluated on every pulse as it is pushed into the ring, and a
+ frame is made only when it fires, from the requested number of
+ samples before the trigger and the rest of the block after it.
+ Along the beam, each frame is taken from the next item received.
+ Work is shared between subscribers: views that select the same
+ channel, gate (or along beam) and block size share one gather, and
+ those that also agree on windowing share one frame, and thus one fft.
+
+ Each TimeSeries delivered to newTSItemSlot() is returned exactly once
+ with returnTSItem(), after all of the subscribers' samples have been
+ taken from it, no matter how many views are attached.
+
+ By default the engine processes each item in the thread that
+ delivers it. A WorkerConfig can instead give it worker threads, with
+ the channels divided among them. Each worker owns the buffers for
+ its channels, allocates them itself (so that, when pinned, they are
+ local to its NUMA node), and can be pinned to cores and given a
+ scheduling priority, to keep the scope off the cores used by the
+ signal processor. frameReady() and returnTSItem() are then emitted
+ from the workers, and reach the views and the data provider through
+ queued connections.
+
+ An AScope which is not given an engine creates a private one, so
+ that a single scope behaves exactly as before. To drive several views
+ from one stream, create an AScopeEngine, pass it to each AScope, and
+ connect the data provider to the engine rather than to the views.
+ **/
+class AScopeEngine : public QObject {
+	Q_OBJECT
+
+public:
+	/// The data that a subscriber wants to see.
+	class Selection {
+	public:
+		Selection();
+		/// The channel
+		int channel;
+		/// The gate, zero based. Ignored when alongBeam is set.
+		int gate;
+		/// Set true to take data along the beam, rather
+		/// than in time at one gate.
+		bool alongBeam;
+		/// The block size. This is the time series length
+		/// in fixed gate mode, and the fft length.
+		int blockSize;
+		/// Set true to apply the hamming window before the fft.
+		bool window;
+		/// Set true if the power spectrum is needed.
+		bool spectrum;
+		/// The spectrum zoom factor. If greater than one, in fixed gate
+		/// mode, blockSize*zoom samples (plus a few for the decimation
+		/// filter) are gathered, and the spectrum covers 1/zoom of the
+		/// sample rate, centered on zoomCenterHz, with zoom times the
+		/// frequency resolution. Ignored along the beam.
+		int zoom;
+		/// The center frequency of the zoomed spectrum, in Hz.
+		double zoomCenterHz;
+		/// @return The zoom factor in effect.
+		int effectiveZoom() const { return (alongBeam || effectivePair() >= 0) ? 1 : zoom; }
+		/// The conditioning applied to the time series before the
+		/// products are computed. If it decimates, the gather is
+		/// lengthened by the decimation factor, so that blockSize
+		/// samples remain. It is not applied along the beam.
+		PreFilterSpec preFilter;
+		/// @return The conditioning in effect.
+		PreFilterSpec effectivePreFilter() const;
+		/// The trigger. If enabled, a frame is delivered only when
+		/// the trigger fires. Ignored along the beam.
+		TriggerSpec trigger;
+		/// @return The trigger in effect.
+		TriggerSpec effectiveTrigger() const;
+		/// The second channel for cross-channel products, or -1. If
+		/// set, in fixed gate mode, blockSize*crossSegments samples are
+		/// gathered from the gate on both channels, ending on the same
+		/// pulse, and the frame carries their cross spectra (see
+		/// ScopeFrame::cross). The channels are paired by counting
+		/// pulses, so both must deliver every pulse. Zoom and trigger
+		/// do not apply.
+		int pairChannel;
+		/// The number of segments averaged for the cross-channel
+		/// products. The coherence needs several.
+		int crossSegments;
+		/// @return The second channel in effect, or -1.
+		int effectivePair() const;
+		/// Along the beam, set true to receive the power profile of
+		/// every beam since the last frame, rather than one beam's
+		/// time series, for a range-time display. The profiles are
+		/// kept for the channel whether or not a frame is pending,
+		/// up to maxProfiles of them.
+		bool profiles;
+		/// Along the beam, the target detection. The frame then
+		/// carries the targets and the threshold along the beam.
+		/// Ignored in fixed gate mode.
+		CfarSpec cfar;
+		/// @return The target detection in effect.
+		CfarSpec effectiveCfar() const;
+	};
+
+	/// The most beam profiles kept between frames, per channel
+	static const int maxProfiles = 1024;
+
+	/// How the processing is divided among threads.
+	class WorkerConfig {
+	public:
+		WorkerConfig();
+		/// @return A configuration from the environment. ASCOPE_WORKERS
+		/// sets the number of workers, ASCOPE_CPUS the cores, as a list
+		/// such as "2,3,8-11", ASCOPE_PRIORITY the QThread::Priority
+		/// value (0-7) and ASCOPE_RT_PRIORITY the realtime priority.
+		/// Unset variables keep the defaults.
+		static WorkerConfig fromEnvironment();
+		/// @return The cores in a list such as "2,3,8-11".
+		/// @param list The list.
+		static std::vector<int> parseCpuList(const std::string& list);
+		/// The number of worker threads. Zero, the default, processes
+		/// items in the thread that delivers them to newTSItemSlot().
+		int workers;
+		/// The cores that the workers may run on. If there are at
+		/// least as many cores as workers, worker i is pinned to
+		/// cpus[i]; otherwise each worker may run on any of them.
+		/// Empty for no pinning.
+		std::vector<int> cpus;
+		/// The priority the worker threads are started with.
+		QThread::Priority priority;
+		/// If greater than zero, the workers are switched to SCHED_FIFO
+		/// with this priority. This usually needs privileges; failure
+		/// is reported and the workers carry on with normal scheduling.
+		int realtimePriority;
+	};
+
+	/// Constructor. The fftw plans for all of the block size choices
+	/// are built in the background; ready() is emitted when they
+	/// are done.
+	/// @param parent The parent object.
+	/// @param config The worker threads to use.
+	AScopeEngine(QObject* parent = 0,
+			const WorkerConfig& config = WorkerConfig::fromEnvironment());
+	/// Destructor
+	virtual ~AScopeEngine();
+	/// Add a subscriber.
+	/// @param selection The subscriber's data selection.
+	/// @return The subscriber id, used to identify frames
+	/// delivered via frameReady().
+	int subscribe(const Selection& selection);
+	/// Change a subscriber's selection. Samples already buffered
+	/// for the selected gate are kept, so a new block size can be
+	/// served right away.
+	/// @param id The subscriber id.
+	/// @param selection The new selection.
+	void setSelection(int id, const Selection& selection);
+	/// Remove a subscriber.
+	/// @param id The subscriber id.
+	void unsubscribe(int id);
+	/// Ask for the next frame for a subscriber. frameReady() is
+	/// emitted when the selection can be satisfied: in fixed gate mode,
+	/// as soon as enough samples are buffered. Without workers, this
+	/// may be from within this call. Repeated requests before
+	/// the frame is delivered are coalesced.
+	/// @param id The subscriber id.
+	void requestFrame(int id);
+	/// Ask for a single frame, without subscribing. The frame is
+	/// made by the processing thread exactly as for a subscriber, and
+	/// is not delivered through frameReady(), so no view is involved.
+	/// Use QFuture::result() to wait for it, or a QFutureWatcher to be
+	/// called back when it is ready. A selection without a spectrum
+	/// gives a frame with just the time series and moments. The future
+	/// is canceled if the engine is destroyed first; a caller that
+	/// gives up may cancel it.
+	/// @param selection The data wanted.
+	/// @return The future frame.
+	QFuture<ScopeFramePtr> requestOnce(const Selection& selection);
+	/// @return The block size choices. These are powers of two.
+	static std::vector<int> blockSizeChoices();
+	/// @return The time spent in each pre-filter stage, for the
+	/// frames made with a given pre-filter. Empty if no frames
+	/// have been made with it.
+	/// @param spec The pre-filter.
+	std::vector<PreFilterChain::StageTiming> preFilterTiming(const PreFilterSpec& spec) const;
+	/// @return True if the background fft preparation is finished.
+	bool isReady() const;
+	/// @return The number of items received.
+	long long itemCount() const;
+	/// @return The number of gates in the data, or 0 if nothing
+	/// has been received yet. gatesChanged() is emitted when it
+	/// changes.
+	int gates() const;
+	/// @return A snapshot of the power statistics of every gate of
+	/// a channel, over the pulses since they were last reset. Empty
+	/// if nothing has been received on the channel.
+	/// @param channel The channel.
+	GateStats gateStats(int channel) const;
+	/// Start the gate statistics over.
+	/// @param channel The channel, or -1 for all of them.
+	void resetGateStats(int channel = -1);
+	/// Turn the gate statistics on or off. Keeping them costs a pass
+	/// over every gate of every pulse, so they are only on by default
+	/// if there are worker threads; without workers that pass would
+	/// run in the thread that delivers the data.
+	/// @param enabled True to keep them.
+	void setGateStatsEnabled(bool enabled);
+	/// @return True if the gate statistics are kept.
+	bool gateStatsEnabled() const;
+	/// Limit the work along the beam to a window of gates. Beam
+	/// frames, range-time profiles and the gate statistics then only
+	/// cover the gates in the window, and the profiles and statistics
+	/// start over. Fixed gate gathers are not affected. The window
+	/// applies to every subscriber.
+	/// @param window The gates of interest.
+	void setGateWindow(const GateWindow& window);
+	/// @return The window of gates along the beam.
+	GateWindow gateWindow() const;
+	/// @return The worker configuration.
+	const WorkerConfig& workerConfig() const { return _config; }
+
+signals:
+	/// emitted when the engine is done with an item.
+	/// @param pItem The item that was delivered to newTSItemSlot().
+	void returnTSItem(AScope::TimeSeries pItem);
+	/// emitted when the engine is done with all of the items of a batch.
+	/// @param batch The batch that was delivered to newTSBatchSlot().
+	void returnTSBatch(AScope::TimeSeriesBatch batch);
+	/// emitted when a frame is available for a subscriber. The same
+	/// frame may be delivered to several subscribers.
+	/// @param id The subscriber id.
+	/// @param frame The frame.
+	void frameReady(int id, ScopeFramePtr frame);
+	/// emitted when the number of gates in the data stream changes,
+	/// including when the first item is received.
+	/// @param gates The number of gates.
+	void gatesChanged(int gates);
+	/// emitted when setGateWindow() changes the window of gates.
+	/// @param window The new window.
+	void gateWindowChanged(GateWindow window);
+	/// emitted once, when the background fft preparation is finished.
+	void ready();
+
+public slots:
+	/// Feed new timeseries data via this slot.
+	/// @param pItem This contains some metadata and pointers to I/Q data
+	void newTSItemSlot(const AScope::TimeSeries& pItem);
+	/// Feed a batch of items via this slot. The items are processed as
+	/// if each had come through newTSItemSlot(), but each shard takes
+	/// its lock once for the batch, and the batch is returned with one
+	/// returnTSBatch() instead of a returnTSItem() per item.
+	/// @param batch The items.
+	void newTSBatchSlot(AScope::TimeSeriesBatch batch);
+
+protected slots:
+	/// Called when the background fft preparation has finished.
+	void fftPreparedSlot();
+
+protected:
+	friend class AScopeEngineWorker;
+
+	/// Identifies the samples to be gathered. Subscribers with
+	/// equal keys share one gather.
+	class GatherKey {
+	public:
+		GatherKey(const Selection& s);
+		bool operator<(const GatherKey& other) const;
+		int channel;
+		int gate;
+		bool alongBeam;
+		/// the number of samples to gather in fixed gate mode
+		int length;
+		/// the trigger, if the gather is triggered
+		TriggerSpec trigger;
+		/// true for beam profiles, along the beam
+		bool profiles;
+		/// the second channel of a two channel gather, or -1
+		int pairChannel;
+		/// @return The number of samples before the trigger.
+		int preSamples() const;
+	};
+	/// Identifies a frame made from a gather. Subscribers
+	/// with equal keys share one frame.
+	class FrameKey {
+	public:
+		FrameKey(const Selection& s);
+		bool operator<(const FrameKey& other) const;
+		int blockSize;
+		bool window;
+		int zoom;
+		double zoomCenterHz;
+		PreFilterSpec preFilter;
+		CfarSpec cfar;
+	};
+	/// A subscriber's state
+	class Subscriber {
+	public:
+		Subscriber(): pending(false), oneShot(false), nextProfile(-1) {}
+		/// The selection
+		Selection selection;
+		/// True if a frame has been requested
+		bool pending;
+		/// True for a requestOnce() request, which is removed
+		/// once its frame is made
+		bool oneShot;
+		/// Completed with the frame, for a one shot request
+		QFutureInterface<ScopeFramePtr> promise;
+		/// For beam profiles, the number of the first profile not
+		/// yet delivered, or -1 before the first frame
+		long long nextProfile;
+	};
+	/// The samples gathered for one GatherKey
+	class Group {
+	public:
+		/// The I values
+		std::vector<double> I;
+		/// The Q values
+		std::vector<double> Q;
+	};
+	/// Where the latest samples of a gate's ring end
+	class SamplesEnd {
+	public:
+		/// The number of pulses received on the channel; the
+		/// last sample is from the last of them
+		long long pulses;
+		/// The acquisition time of the channel's newest item,
+		/// or 0 if unknown
+		double timestamp;
+		/// The pulse rate of the channel
+		double sampleRateHz;
+	};
+	/// How the pulse counts of two channels line up, for a two
+	/// channel gather. Without timestamps the pulses are paired by
+	/// count, and a dropped or extra pulse on one channel changes
+	/// the difference for good. If the offset is not seen while both
+	/// channels move on by a whole gather, the smallest difference
+	/// seen meanwhile, which is the one when neither channel is
+	/// ahead, is taken as the new offset.
+	class PairAlignment {
+	public:
+		PairAlignment(): offset(0), closest(0), since1(-1), since2(-1) {}
+		/// The difference in pulse counts, first channel minus
+		/// second, when the channels end on the same pulse
+		long long offset;
+		/// The difference closest to zero since the offset was last seen
+		long long closest;
+		/// The first channel's count when the offset was last seen,
+		/// or -1 if it was seen on the last comparison
+		long long since1;
+		/// The second channel's count when the offset was last seen
+		long long since2;
+	};
+	/// The state of a triggered gather
+	class Capture {
+	public:
+		Capture(const TriggerSpec& spec): detector(spec), triggerAt(-1) {}
+		/// Evaluates the trigger
+		TriggerDetector detector;
+		/// The ring sample number at which the trigger fired,
+		/// or -1 if waiting for a trigger.
+		long long triggerAt;
+	};
+	/// The recent beam power profiles of one channel
+	class Profiles {
+	public:
+		Profiles(): gates(0), first(0), total(0) {}
+		/// Append the power profile of the first pulse of an item,
+		/// starting over if the number of gates or the window has
+		/// changed.
+		/// @param pItem The item.
+		/// @param window The gates to keep.
+		void push(const AScope::TimeSeries& pItem, const GateWindow& window);
+		/// The number of gates in each profile
+		int gates;
+		/// The gates kept
+		GateWindow window;
+		/// maxProfiles profiles of gates values, in dB, circular
+		std::vector<float> data;
+		/// The number of the oldest profile since the last restart
+		long long first;
+		/// The number of profiles pushed
+		long long total;
+		/// The I values of the latest pulse
+		std::vector<double> I;
+		/// The Q values of the latest pulse
+		std::vector<double> Q;
+	};
+	/// A frame waiting to be delivered
+	typedef std::pair<int, ScopeFramePtr> Delivery;
+	/// Identifies a ring: the channel and gate
+	typedef std::pair<int, int> RingKey;
+
+	/// The processing state for a subset of the channels. Each shard
+	/// is fed by one thread, and the shards are processed independently.
+	class Shard {
+	public:
+		Shard();
+		~Shard();
+		/// @return The spectrum calculator for a block size.
+		/// @param blockSize The block size.
+		SpectrumCalc& spectrumCalc(int blockSize);
+		/// @return The pre-filter chain for a spec.
+		/// @param spec The pre-filter.
+		PreFilterChain& preFilterChain(const PreFilterSpec& spec);
+		/// @return The target detector for a spec.
+		/// @param spec The detection.
+		CfarDetector& cfarDetector(const CfarSpec& spec);
+		/// Protects everything in the shard. When both are needed,
+		/// it is locked before _subscriberMutex.
+		mutable QMutex mutex;
+		/// The fixed gate sample buffers, by channel and gate
+		std::map<RingKey, GateRing*> rings;
+		/// The triggered gathers
+		std::map<GatherKey, Capture*> captures;
+		/// The ring capacities wanted, to be applied by applyPlan()
+		std::map<RingKey, int> ringPlan;
+		/// The triggered gathers wanted, to be applied by applyPlan()
+		std::set<GatherKey> capturePlan;
+		/// The beam profiles, by channel
+		std::map<int, Profiles*> profiles;
+		/// The channels that want beam profiles, to be applied by applyPlan()
+		std::set<int> profilePlan;
+		/// True if the plans have changed since they were applied
+		bool planChanged;
+		/// Spectrum calculators, by block size
+		std::map<int, SpectrumCalc*> calcs;
+		/// Pre-filter chains, by spec
+		std::map<PreFilterSpec, PreFilterChain*> chains;
+		/// Target detectors, by spec
+		std::map<CfarSpec, CfarDetector*> cfars;
+		/// The number of pulses received, by channel
+		std::map<int, long long> pulses;
+		/// The acquisition time of the newest item, by channel
+		std::map<int, double> timestamps;
+		/// The time the newest item waited to be ingested, by channel
+		std::map<int, double> queueSecs;
+		/// The power statistics of every gate, by channel
+		std::map<int, GateStats> gateStats;
+		/// Set true if gateStats are kept
+		bool gateStatsEnabled;
+		/// The gates of interest along the beam
+		GateWindow gateWindow;
+		/// Space for the I values of one gate of an item
+		std::vector<double> gatherI;
+		/// Space for the Q values of one gate of an item
+		std::vector<double> gatherQ;
+		/// The number of gates in this shard's data
+		int gates;
+		/// The sample rate in Hz, from this shard's data
+		double sampleRateHz;
+	private:
+		Shard(const Shard&);
+		Shard& operator=(const Shard&);
+	};
+
+	/// @return The index of the shard that handles a channel.
+	/// @param channel The channel.
+	int shardIndex(int channel) const;
+	/// Work out the rings and captures that each shard needs from
+	/// the selections, and hand the plans to the shards. Neither
+	/// _subscriberMutex nor a shard mutex may be held.
+	void updateRings();
+	/// Create, resize or remove the rings so that there is one for
+	/// each channel and gate selected in fixed gate mode, large enough
+	/// for the longest gather on that gate, a capture for each
+	/// triggered gather, and profiles for each channel with a
+	/// range-time selection. This is done in the thread that feeds the
+	/// shard, so that the buffers are allocated local to it.
+	/// The shard mutex must be held.
+	/// @param shard The shard.
+	void applyPlan(Shard& shard);
+	/// Process an item: the body of newTSItemSlot(), run in the
+	/// thread that feeds the item's shard.
+	/// @param index The shard index.
+	/// @param pItem The item.
+	/// @param arrival When the item reached newTSItemSlot(), from now().
+	void ingestItem(int index, const AScope::TimeSeries& pItem, double arrival);
+	/// Process the items of a batch that belong to a shard: the body
+	/// of newTSBatchSlot(), run in the thread that feeds the shard.
+	/// The last shard to finish returns the batch.
+	/// @param index The shard index.
+	/// @param batch The batch.
+	/// @param arrival When the batch reached newTSBatchSlot(), from now().
+	void ingestBatch(int index, AScope::TimeSeriesBatch batch, double arrival);
+	/// Take the samples of the items that belong to a shard, with
+	/// the shard locked once, and make the frames that are due.
+	/// @param index The shard index.
+	/// @param items The items; those of other shards are skipped.
+	/// @param count The number of items.
+	/// @param arrival When the items reached the engine, from now().
+	/// @param deliveries The frames made are appended here.
+	/// @return The new number of gates, if it changed, else -1.
+	int ingestItems(int index, const AScope::TimeSeries* items, int count,
+			double arrival, std::vector<Delivery>& deliveries);
+	/// Serve the pending fixed gate subscribers of a shard
+	/// from its rings, and deliver the frames.
+	/// @param index The shard index.
+	void serveShard(int index);
+	/// Apply the worker configuration to the calling thread.
+	/// @param index The worker index.
+	void configureThread(int index);
+	/// Push the samples for one gate of an item into its ring,
+	/// running the triggers on that gate, and make frames for the
+	/// pending triggered gathers that complete. The shard mutex
+	/// must be held.
+	/// @param shard The shard.
+	/// @param key The ring's key.
+	/// @param ring The ring.
+	/// @param pItem The item.
+	/// @param pending The triggered gathers that have a pending subscriber.
+	/// @param deliveries The frames are appended here.
+	void ingest(Shard& shard, const RingKey& key, GateRing& ring,
+			const AScope::TimeSeries& pItem, const std::set<GatherKey>& pending,
+			std::vector<Delivery>& deliveries);
+	/// Serve the pending fixed gate subscribers of a shard whose
+	/// rings hold enough samples. The shard mutex must be held.
+	/// @param shard The shard.
+	/// @param index The shard index.
+	/// @param deliveries The frames are appended here.
+	void serveRings(Shard& shard, int index, std::vector<Delivery>& deliveries);
+	/// Serve the pending two channel subscribers that either channel
+	/// of which is fed by a shard, if both channels' rings hold enough
+	/// samples ending on the same pulse. The rings are copied one
+	/// shard at a time, so no mutex may be held.
+	/// @param index The shard index.
+	/// @param deliveries The frames are appended here.
+	void servePairs(int index, std::vector<Delivery>& deliveries);
+	/// Copy the latest samples from a gate's ring.
+	/// @param channel The channel.
+	/// @param gate The gate.
+	/// @param length The number of samples.
+	/// @param group The samples are returned here.
+	/// @param end Where the samples end is returned here.
+	/// @return True if the ring exists and holds enough samples.
+	bool latestSamples(int channel, int gate, int length, Group& group, SamplesEnd& end);
+	/// Decide whether the latest samples of the two channels of a
+	/// two channel gather are from the same pulses. If both channels
+	/// carry timestamps, they must agree to half a pulse; otherwise
+	/// the pulse counts must differ by the offset in _pairAlignments.
+	/// @param key The gather.
+	/// @param end1 Where the first channel's samples end.
+	/// @param end2 Where the second channel's samples end.
+	/// @return True if the samples can be paired.
+	bool pairAligned(const GatherKey& key, const SamplesEnd& end1, const SamplesEnd& end2);
+	/// Create the cross-channel frames for a two channel gather, and
+	/// queue them for delivery to all of the waiting subscribers.
+	/// The shard mutex must be held.
+	/// @param shard The shard.
+	/// @param key The gather's key.
+	/// @param first The samples of the first channel.
+	/// @param second The samples of the second channel.
+	/// @param deliveries The frames are appended here.
+	void processPair(Shard& shard, const GatherKey& key, Group& first, Group& second,
+			std::vector<Delivery>& deliveries);
+	/// Emit frameReady() for each delivery, or complete the future
+	/// for a one shot request. No mutex may be held.
+	/// @param deliveries The frames to deliver.
+	void deliver(const std::vector<Delivery>& deliveries);
+	/// Create the frames for a full group, and queue them for
+	/// delivery to all of the waiting subscribers. The shard
+	/// mutex must be held.
+	/// @param shard The shard.
+	/// @param key The group's key.
+	/// @param group The group.
+	/// @param deliveries The frames are appended here.
+	void process(Shard& shard, const GatherKey& key, Group& group,
+			std::vector<Delivery>& deliveries);
+	/// Create a frame of the beam profiles that a subscriber has
+	/// not yet seen. The shard mutex must be held.
+	/// @param shard The shard.
+	/// @param channel The channel.
+	/// @param from The first profile wanted, or -1 for all of them.
+	/// @return The frame.
+	ScopeFramePtr profileFrame(Shard& shard, int channel, long long from);
+	/// Complete the timing of a frame: the acquisition time and
+	/// ingest delay of the channel's newest item, the processing
+	/// time and the time the frame is ready.
+	/// @param shard The shard.
+	/// @param frame The frame, with its channel set.
+	/// @param start When processing of the frame started, from now().
+	void finishFrame(const Shard& shard, ScopeFrame* frame, double start);
+
+	/// Protects _subscribers, _nextId, _gates and _itemCount
+	mutable QMutex _subscriberMutex;
+	/// Serializes updateRings(), so that plans are handed
+	/// to the shards in the order they were made.
+	QMutex _planMutex;
+	/// The subscribers, by id
+	std::map<int, Subscriber> _subscribers;
+	/// The id to assign to the next subscriber
+	int _nextId;
+	/// The processing state, one shard per worker, or
+	/// just one if there are no workers
+	std::vector<Shard*> _shards;
+	/// The worker configuration
+	WorkerConfig _config;
+	/// The worker threads
+	std::vector<QThread*> _threads;
+	/// The workers, one per thread
+	std::vector<AScopeEngineWorker*> _workers;
+	/// The number of gates. Initially zero, it is diagnosed from the data stream
+	int _gates;
+	/// The number of items received
+	long long _itemCount;
+	/// The pulse count offsets of the two channel gathers, protected
+	/// by _subscriberMutex
+	std::map<GatherKey, PairAlignment> _pairAlignments;
+	/// Watches the background fft preparation.
+	QFutureWatcher<void> _fftPrepWatcher;
+	/// Set true when the background fft preparation is finished.
+	bool _ready;
+};
+
+/**
+ An AScopeEngineWorker lives in one of the engine's worker threads,
+ and runs the engine's processing for one shard there. Its slots are
+ invoked through queued connections.
+ **/
+class AScopeEngineWorker : public QObject {
+	Q_OBJECT
+
+public:
+	/// Constructor
+	/// @param engine The engine.
+	/// @param index The worker, and shard, index.
+	AScopeEngineWorker(AScopeEngine& engine, int index);
+	/// Destructor
+	virtual ~AScopeEngineWorker();
+
+public slots:
+	/// Apply the thread configuration. Connected to QThread::started().
+	void startSlot();
+	/// Process an item.
+	/// @param pItem The item.
+	/// @param arrival When the item reached the engine.
+	void itemSlot(AScope::TimeSeries pItem, double arrival);
+	/// Process the items of a batch that belong to this worker's shard.
+	/// @param batch The batch.
+	/// @param arrival When the batch reached the engine.
+	void batchSlot(AScope::TimeSeriesBatch batch, double arrival);
+	/// Serve pending requests from the rings.
+	void serveSlot();
+	/// Stop the thread, once the items queued ahead of this are done.
+	void stopSlot();
+
+protected:
+	/// The engine
+	AScopeEngine& _engine;
+	/// The worker index
+	int _index;
+};
+
+#endif
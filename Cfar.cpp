@@ -0,0 +1,244 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "Cfar.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	/// @return The false alarm probability of OS-CFAR in exponentially
+	/// distributed (square law detected) noise:
+	/// prod(i = 0..k-1) (N - i)/(N - i + a).
+	/// @param cells The number of training cells, N.
+	/// @param k The rank of the noise estimate among them.
+	/// @param a The threshold factor.
+	double osPfa(int cells, int k, double a) {
+		double p = 1.0;
+		for (int i = 0; i < k; i++) {
+			p *= (cells - i)/(cells - i + a);
+		}
+		return p;
+	}
+}
+
+////////////////////////////////////////////////////////
+CfarSpec::CfarSpec():
+mode(OFF),
+trainingCells(16),
+guardCells(2),
+pfa(1.0e-6),
+rank(0.75)
+{
+}
+
+////////////////////////////////////////////////////////
+bool
+CfarSpec::operator<(const CfarSpec& o) const
+{
+	if (mode != o.mode)
+		return mode < o.mode;
+	if (mode == OFF)
+		return false;
+	if (trainingCells != o.trainingCells)
+		return trainingCells < o.trainingCells;
+	if (guardCells != o.guardCells)
+		return guardCells < o.guardCells;
+	if (pfa != o.pfa)
+		return pfa < o.pfa;
+	if (mode == ORDERED_STATISTIC)
+		return rank < o.rank;
+	return false;
+}
+
+////////////////////////////////////////////////////////
+bool
+CfarSpec::operator==(const CfarSpec& o) const
+{
+	return !(*this < o) && !(o < *this);
+}
+
+////////////////////////////////////////////////////////
+CfarDetector::CfarDetector(const CfarSpec& spec):
+_spec(spec),
+_sum(0.0),
+_count(0)
+{
+	if (_spec.trainingCells < 1) {
+		_spec.trainingCells = 1;
+	}
+	if (_spec.guardCells < 0) {
+		_spec.guardCells = 0;
+	}
+	_scales.assign(2*_spec.trainingCells + 1, 0.0);
+}
+
+////////////////////////////////////////////////////////
+CfarDetector::~CfarDetector()
+{
+}
+
+////////////////////////////////////////////////////////
+double
+CfarDetector::scale(int cells)
+{
+	if (cells < 1 || cells >= (int)_scales.size()) {
+		return HUGE_VAL;
+	}
+	double& a = _scales[cells];
+	if (a > 0.0) {
+		return a;
+	}
+	double pfa = _spec.pfa;
+	if (_spec.mode == CfarSpec::ORDERED_STATISTIC) {
+		// Pfa falls steadily with a; grow a bracket
+		// around the wanted value, then bisect it.
+		int k = std::max(1, std::min(cells, (int)floor(_spec.rank*cells + 0.5)));
+		double lo = 0.0;
+		double hi = 1.0;
+		while (osPfa(cells, k, hi) > pfa && hi < 1.0e12) {
+			lo = hi;
+			hi *= 2.0;
+		}
+		for (int iter = 0; iter < 100 && hi - lo > 1.0e-9*hi; iter++) {
+			double mid = (lo + hi)/2.0;
+			if (osPfa(cells, k, mid) > pfa) {
+				lo = mid;
+			} else {
+				hi = mid;
+			}
+		}
+		a = hi;
+	} else {
+		// Pfa = (1 + a/N)^-N for the mean of N exponential cells
+		a = cells*(pow(pfa, -1.0/cells) - 1.0);
+	}
+	return a;
+}
+
+////////////////////////////////////////////////////////
+void
+CfarDetector::add(double p)
+{
+	_sum += p;
+	_count++;
+	if (_spec.mode == CfarSpec::ORDERED_STATISTIC) {
+		_sorted.insert(std::lower_bound(_sorted.begin(), _sorted.end(), p), p);
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+CfarDetector::remove(double p)
+{
+	_sum -= p;
+	_count--;
+	if (_spec.mode == CfarSpec::ORDERED_STATISTIC) {
+		_sorted.erase(std::lower_bound(_sorted.begin(), _sorted.end(), p));
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+CfarDetector::detect(const double* power, int n,
+		CfarDetections& detections, std::vector<double>& threshold)
+{
+	detections.clear();
+	threshold.resize(n);
+	if (_spec.mode == CfarSpec::OFF || n <= 0) {
+		threshold.clear();
+		return;
+	}
+
+	int T = _spec.trainingCells;
+	int G = _spec.guardCells;
+	_sum = 0.0;
+	_count = 0;
+	_sorted.clear();
+
+	// the lagging window of the first gate; its leading
+	// window is before the start of the beam
+	for (int j = G + 1; j <= G + T && j < n; j++) {
+		add(power[j]);
+	}
+
+	// a floor keeps empty gates finite in dB
+	const double tiny = 1.0e-30;
+	bool inRun = false;
+	for (int i = 0; i < n; i++) {
+		if (i > 0) {
+			// slide both windows along by one gate
+			int in = i - G - 1;
+			if (in >= 0) {
+				add(power[in]);
+			}
+			int out = i - G - T - 1;
+			if (out >= 0) {
+				remove(power[out]);
+			}
+			out = i + G;
+			if (out < n) {
+				remove(power[out]);
+			}
+			in = i + G + T;
+			if (in < n) {
+				add(power[in]);
+			}
+		}
+
+		double noise = 0.0;
+		if (_count > 0) {
+			if (_spec.mode == CfarSpec::ORDERED_STATISTIC) {
+				int k = std::max(1, std::min(_count, (int)floor(_spec.rank*_count + 0.5)));
+				noise = _sorted[k - 1];
+			} else {
+				// the running sum can be left slightly negative by rounding
+				noise = std::max(_sum, 0.0)/_count;
+			}
+		}
+		if (_count == 0) {
+			// no training cells on a very short beam; nothing to compare with
+			threshold[i] = 10.0*log10(power[i] + tiny);
+			inRun = false;
+			continue;
+		}
+		double t = scale(_count)*noise;
+		threshold[i] = 10.0*log10(t + tiny);
+
+		if (power[i] > t) {
+			double p = 10.0*log10(power[i] + tiny);
+			double snr = p - 10.0*log10(noise + tiny);
+			// one detection per run of gates, at the strongest
+			if (inRun) {
+				if (p > detections.back().power) {
+					detections.back() = CfarDetection(i, p, snr);
+				}
+			} else {
+				detections.push_back(CfarDetection(i, p, snr));
+			}
+			inRun = true;
+		} else {
+			inRun = false;
+		}
+	}
+}
@@ -0,0 +1,135 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef CFARINC_
+#define CFARINC_
+
+#include <vector>
+
+/**
+ CfarSpec describes constant false alarm rate target detection
+ along the beam. Each gate (the cell under test) is compared with
+ the noise estimated from the training cells on either side of it,
+ leaving out the guard cells next to it, which a target may spill
+ into. It is a value type, so that it can be part of a selection
+ and compared.
+ **/
+class CfarSpec {
+public:
+	/// How the noise is estimated from the training cells
+	enum Mode {
+		/// No detection
+		OFF,
+		/// The mean of the training cells (CA-CFAR)
+		CELL_AVERAGING,
+		/// The k-th smallest of the training cells (OS-CFAR),
+		/// which tolerates other targets among them
+		ORDERED_STATISTIC
+	};
+	CfarSpec();
+	bool operator<(const CfarSpec& other) const;
+	bool operator==(const CfarSpec& other) const;
+	/// @return True if detection is enabled.
+	bool enabled() const { return mode != OFF; }
+	/// The noise estimator
+	Mode mode;
+	/// The number of training cells on each side
+	int trainingCells;
+	/// The number of guard cells on each side
+	int guardCells;
+	/// The probability of false alarm in noise, which sets
+	/// the threshold over the noise estimate
+	double pfa;
+	/// For ORDERED_STATISTIC, which of the training cells, as a
+	/// fraction of them counting from the weakest, is the estimate
+	double rank;
+};
+
+/**
+ A target found by CfarDetector
+ **/
+class CfarDetection {
+public:
+	CfarDetection(int g = 0, double p = 0.0, double s = 0.0):
+		gate(g), power(p), snr(s) {}
+	/// The gate
+	int gate;
+	/// The power, in dB
+	double power;
+	/// The power relative to the noise estimate, in dB
+	double snr;
+};
+
+/// The targets along one beam
+typedef std::vector<CfarDetection> CfarDetections;
+
+/**
+ CfarDetector applies a CfarSpec to power profiles. The training
+ windows slide along the beam one gate at a time: cell averaging
+ keeps running sums, so the cost per gate does not depend on the
+ window size, and the ordered statistic keeps the window sorted,
+ at a binary search and a short move per gate. A run of adjacent
+ gates over the threshold is reported once, at its strongest gate.
+
+ The thresholds for each number of training cells are worked
+ out once and kept, so a detector should be reused.
+ **/
+class CfarDetector {
+public:
+	/// Constructor
+	/// @param spec The detection.
+	CfarDetector(const CfarSpec& spec = CfarSpec());
+	/// Destructor
+	virtual ~CfarDetector();
+	/// Find the targets in a power profile.
+	/// @param power The power of each gate, in linear units.
+	/// @param n The number of gates.
+	/// @param detections The targets are returned here.
+	/// @param threshold The detection threshold of each gate, in dB,
+	/// is returned here.
+	void detect(const double* power, int n,
+			CfarDetections& detections, std::vector<double>& threshold);
+	/// @return The factor over the noise estimate for a number of
+	/// training cells, for the spec's false alarm probability.
+	/// @param cells The number of training cells.
+	double scale(int cells);
+
+protected:
+	/// Add a training cell.
+	void add(double p);
+	/// Remove a training cell.
+	void remove(double p);
+	/// The detection
+	CfarSpec _spec;
+	/// The threshold factors, by number of training cells;
+	/// zero until worked out.
+	std::vector<double> _scales;
+	/// The sum of the training cells
+	double _sum;
+	/// The number of training cells
+	int _count;
+	/// The training cells, in order, for ORDERED_STATISTIC
+	std::vector<double> _sorted;
+};
+
+#endif
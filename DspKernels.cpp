@@ -0,0 +1,359 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "DspKernels.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <cstdlib>
+#include <iostream>
+
+// The SIMD variants are built with gcc's per function target
+// attributes, so that the rest of the library keeps the generic
+// code generation flags.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ASCOPE_X86_KERNELS
+#endif
+
+// AVX-512 brings fused multiply-add with it; contracting the
+// multiply-adds would make that variant's results differ from
+// the others.
+#pragma GCC optimize ("fp-contract=off")
+
+namespace {
+
+/// Each variant gets its own inlined copy of the kernel bodies
+/// below, compiled for its instruction set.
+#define KERNEL inline __attribute__((always_inline))
+
+/// The reductions keep this many independent partial results, which
+/// fills an AVX-512 register of doubles and lets the compiler
+/// vectorize them without reassociating. All variants use the same
+/// number, and so add in the same order and agree exactly.
+const int LANES = 8;
+
+////////////////////////////////////////////////////////
+template <typename T>
+KERNEL void
+gather(void* const* beams, int count, int gate,
+		double* __restrict__ I, double* __restrict__ Q)
+{
+	for (int t = 0; t < count; t++) {
+		const T* iq = static_cast<const T*>(beams[t]) + 2*gate;
+		I[t] = iq[0];
+		Q[t] = iq[1];
+	}
+}
+
+////////////////////////////////////////////////////////
+template <typename T>
+KERNEL void
+deinterleave(const T* __restrict__ iq, int n,
+		double* __restrict__ I, double* __restrict__ Q)
+{
+	for (int j = 0; j < n; j++) {
+		I[j] = iq[2*j];
+		Q[j] = iq[2*j+1];
+	}
+}
+
+////////////////////////////////////////////////////////
+KERNEL void
+interleave(const double* __restrict__ I, const double* __restrict__ Q,
+		int n, double* __restrict__ z)
+{
+	for (int j = 0; j < n; j++) {
+		z[2*j] = I[j];
+		z[2*j+1] = Q[j];
+	}
+}
+
+////////////////////////////////////////////////////////
+KERNEL void
+window(double* __restrict__ z, const double* __restrict__ w, int n)
+{
+	for (int j = 0; j < n; j++) {
+		z[2*j] *= w[j];
+		z[2*j+1] *= w[j];
+	}
+}
+
+////////////////////////////////////////////////////////
+KERNEL double
+sum(const double* __restrict__ x, int n)
+{
+	double acc[LANES] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+	int j = 0;
+	for (; j + LANES <= n; j += LANES) {
+		for (int l = 0; l < LANES; l++) {
+			acc[l] += x[j+l];
+		}
+	}
+	for (; j < n; j++) {
+		acc[j % LANES] += x[j];
+	}
+	double s = 0.0;
+	for (int l = 0; l < LANES; l++) {
+		s += acc[l];
+	}
+	return s;
+}
+
+////////////////////////////////////////////////////////
+KERNEL double
+power(const double* __restrict__ z, int n, double* __restrict__ p)
+{
+	for (int j = 0; j < n; j++) {
+		p[j] = z[2*j]*z[2*j] + z[2*j+1]*z[2*j+1];
+	}
+	return sum(p, n);
+}
+
+////////////////////////////////////////////////////////
+KERNEL double
+sumSquares(const double* __restrict__ I, const double* __restrict__ Q, int n)
+{
+	double acc[LANES] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+	int j = 0;
+	for (; j + LANES <= n; j += LANES) {
+		for (int l = 0; l < LANES; l++) {
+			acc[l] += I[j+l]*I[j+l] + Q[j+l]*Q[j+l];
+		}
+	}
+	for (; j < n; j++) {
+		acc[j % LANES] += I[j]*I[j] + Q[j]*Q[j];
+	}
+	double s = 0.0;
+	for (int l = 0; l < LANES; l++) {
+		s += acc[l];
+	}
+	return s;
+}
+
+////////////////////////////////////////////////////////
+KERNEL void
+minMax(const double* __restrict__ x, int n, double* min, double* max)
+{
+	double lo[LANES];
+	double hi[LANES];
+	for (int l = 0; l < LANES; l++) {
+		lo[l] = hi[l] = x[0];
+	}
+	int j = 0;
+	for (; j + LANES <= n; j += LANES) {
+		for (int l = 0; l < LANES; l++) {
+			double v = x[j+l];
+			lo[l] = v < lo[l] ? v : lo[l];
+			hi[l] = v > hi[l] ? v : hi[l];
+		}
+	}
+	for (; j < n; j++) {
+		double v = x[j];
+		lo[0] = v < lo[0] ? v : lo[0];
+		hi[0] = v > hi[0] ? v : hi[0];
+	}
+	for (int l = 1; l < LANES; l++) {
+		lo[0] = lo[l] < lo[0] ? lo[l] : lo[0];
+		hi[0] = hi[l] > hi[0] ? hi[l] : hi[0];
+	}
+	*min = lo[0];
+	*max = hi[0];
+}
+
+////////////////////////////////////////////////////////
+KERNEL void
+welford(const double* __restrict__ I, const double* __restrict__ Q, int n,
+		long long count, double* __restrict__ mean, double* __restrict__ m2,
+		double* __restrict__ min, double* __restrict__ max)
+{
+	double scale = 1.0/count;
+	for (int j = 0; j < n; j++) {
+		double p = I[j]*I[j] + Q[j]*Q[j];
+		double delta = p - mean[j];
+		mean[j] += delta*scale;
+		m2[j] += delta*(p - mean[j]);
+		min[j] = p < min[j] ? p : min[j];
+		max[j] = p > max[j] ? p : max[j];
+	}
+}
+
+/// Define the entry points and the table for one variant.
+#define VARIANT(SUFFIX, ISA, NAME, TARGET) \
+TARGET void gatherFloat_##SUFFIX(void* const* b, int c, int g, double* I, double* Q) \
+	{ gather<float>(b, c, g, I, Q); } \
+TARGET void gatherShort_##SUFFIX(void* const* b, int c, int g, double* I, double* Q) \
+	{ gather<short>(b, c, g, I, Q); } \
+TARGET void deinterleaveFloat_##SUFFIX(const float* iq, int n, double* I, double* Q) \
+	{ deinterleave(iq, n, I, Q); } \
+TARGET void deinterleaveShort_##SUFFIX(const short* iq, int n, double* I, double* Q) \
+	{ deinterleave(iq, n, I, Q); } \
+TARGET void interleave_##SUFFIX(const double* I, const double* Q, int n, double* z) \
+	{ interleave(I, Q, n, z); } \
+TARGET void window_##SUFFIX(double* z, const double* w, int n) \
+	{ window(z, w, n); } \
+TARGET double power_##SUFFIX(const double* z, int n, double* p) \
+	{ return power(z, n, p); } \
+TARGET double sumSquares_##SUFFIX(const double* I, const double* Q, int n) \
+	{ return sumSquares(I, Q, n); } \
+TARGET void minMax_##SUFFIX(const double* x, int n, double* min, double* max) \
+	{ minMax(x, n, min, max); } \
+TARGET void welford_##SUFFIX(const double* I, const double* Q, int n, long long c, \
+		double* mean, double* m2, double* min, double* max) \
+	{ welford(I, Q, n, c, mean, m2, min, max); } \
+const DspKernels kernels_##SUFFIX = { \
+	DspKernels::ISA, NAME, \
+	gatherFloat_##SUFFIX, gatherShort_##SUFFIX, \
+	deinterleaveFloat_##SUFFIX, deinterleaveShort_##SUFFIX, \
+	interleave_##SUFFIX, window_##SUFFIX, power_##SUFFIX, \
+	sumSquares_##SUFFIX, minMax_##SUFFIX, welford_##SUFFIX \
+};
+
+VARIANT(generic, GENERIC, "generic", )
+#ifdef ASCOPE_X86_KERNELS
+VARIANT(sse2, SSE2, "sse2", __attribute__((target("sse2"))))
+VARIANT(avx2, AVX2, "avx2", __attribute__((target("avx2"))))
+VARIANT(avx512, AVX512, "avx512", __attribute__((target("avx512f"))))
+#endif
+
+/// The variant names, indexed by DspKernels::Isa; the names are
+/// known even where the variants are not built.
+const char* const kernelNames[] = { "generic", "sse2", "avx2", "avx512" };
+
+/// Serializes the choice of variant
+QMutex selectMutex;
+
+} // namespace
+
+const DspKernels* volatile DspKernels::_active = 0;
+
+////////////////////////////////////////////////////////
+const DspKernels&
+DspKernels::table(Isa isa)
+{
+#ifdef ASCOPE_X86_KERNELS
+	switch (isa) {
+	case SSE2:
+		return kernels_sse2;
+	case AVX2:
+		return kernels_avx2;
+	case AVX512:
+		return kernels_avx512;
+	default:
+		break;
+	}
+#endif
+	return kernels_generic;
+}
+
+////////////////////////////////////////////////////////
+bool
+DspKernels::lookup(const std::string& name, Isa& isa)
+{
+	Isa all[] = { GENERIC, SSE2, AVX2, AVX512 };
+	for (unsigned int i = 0; i < sizeof(all)/sizeof(all[0]); i++) {
+		if (name == kernelNames[all[i]]) {
+			isa = all[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+////////////////////////////////////////////////////////
+bool
+DspKernels::supported(Isa isa)
+{
+	if (isa == GENERIC) {
+		return true;
+	}
+#ifdef ASCOPE_X86_KERNELS
+	__builtin_cpu_init();
+	switch (isa) {
+	case SSE2:
+		return __builtin_cpu_supports("sse2");
+	case AVX2:
+		return __builtin_cpu_supports("avx2");
+	case AVX512:
+		return __builtin_cpu_supports("avx512f");
+	default:
+		break;
+	}
+#endif
+	return false;
+}
+
+////////////////////////////////////////////////////////
+DspKernels::Isa
+DspKernels::best()
+{
+	Isa isa[] = { AVX512, AVX2, SSE2 };
+	for (unsigned int i = 0; i < sizeof(isa)/sizeof(isa[0]); i++) {
+		if (supported(isa[i])) {
+			return isa[i];
+		}
+	}
+	return GENERIC;
+}
+
+////////////////////////////////////////////////////////
+const DspKernels&
+DspKernels::get()
+{
+	if (!_active) {
+		QMutexLocker locker(&selectMutex);
+		if (!_active) {
+			const DspKernels* kernels = &table(best());
+			const char* s = getenv("ASCOPE_ISA");
+			Isa isa;
+			if (s) {
+				if (lookup(s, isa) && supported(isa)) {
+					kernels = &table(isa);
+				} else {
+					std::cerr << "DspKernels: ASCOPE_ISA=" << s <<
+						" is not available here, using " << kernels->name << std::endl;
+				}
+			}
+			_active = kernels;
+		}
+	}
+	return *_active;
+}
+
+////////////////////////////////////////////////////////
+bool
+DspKernels::select(Isa isa)
+{
+	if (!supported(isa)) {
+		return false;
+	}
+	QMutexLocker locker(&selectMutex);
+	_active = &table(isa);
+	return true;
+}
+
+////////////////////////////////////////////////////////
+bool
+DspKernels::select(const std::string& name)
+{
+	Isa isa;
+	return lookup(name, isa) && select(isa);
+}
@@ -0,0 +1,120 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef DSPKERNELSINC_
+#define DSPKERNELSINC_
+
+#include <string>
+
+/**
+ DspKernels is a table of the inner loops that the scope spends
+ its time in: gathering I and Q from the producer's buffers,
+ windowing, power, moment accumulation and min/max. The library
+ contains a variant of the table for each instruction set it
+ knows about, all compiled from the same source with different
+ code generation targets, so that one build of the library uses
+ AVX-512 or AVX2 where the CPU has them and still runs on hosts
+ with only SSE2.
+
+ The variant is chosen once, the first time get() is called, as
+ the best one that the CPU supports. The environment variable
+ ASCOPE_ISA (generic, sse2, avx2 or avx512) or select() can force
+ a particular variant, for testing and for comparing results;
+ all of the variants produce identical results.
+
+ Arrays passed to the same kernel must not overlap.
+ **/
+class DspKernels {
+public:
+	/// The instruction set variants, from the least to the most capable.
+	enum Isa { GENERIC, SSE2, AVX2, AVX512 };
+
+	/// The variant that this table was compiled for
+	Isa isa;
+	/// The name of the variant, as accepted by ASCOPE_ISA
+	const char* name;
+
+	/// Gather one gate from each of a series of pulses of
+	/// interleaved float I,Q samples.
+	/// @param beams The pulses.
+	/// @param count The number of pulses.
+	/// @param gate The gate.
+	/// @param I The I values are returned here.
+	/// @param Q The Q values are returned here.
+	void (*gatherFloat)(void* const* beams, int count, int gate,
+			double* I, double* Q);
+	/// Gather one gate from each of a series of pulses of
+	/// interleaved short I,Q samples.
+	void (*gatherShort)(void* const* beams, int count, int gate,
+			double* I, double* Q);
+	/// Separate n interleaved float I,Q samples.
+	void (*deinterleaveFloat)(const float* iq, int n, double* I, double* Q);
+	/// Separate n interleaved short I,Q samples.
+	void (*deinterleaveShort)(const short* iq, int n, double* I, double* Q);
+	/// Interleave n I and Q values into complex values.
+	void (*interleave)(const double* I, const double* Q, int n, double* z);
+	/// Multiply n interleaved complex values by a real window.
+	void (*window)(double* z, const double* w, int n);
+	/// Compute the power of n interleaved complex values.
+	/// @param p The powers are returned here.
+	/// @return The sum of the powers.
+	double (*power)(const double* z, int n, double* p);
+	/// @return The sum of I*I + Q*Q over n samples.
+	double (*sumSquares)(const double* I, const double* Q, int n);
+	/// Find the smallest and largest of n values, n > 0.
+	void (*minMax)(const double* x, int n, double* min, double* max);
+	/// Add one pulse to running statistics of the power I*I + Q*Q
+	/// in each of n gates, with Welford's method.
+	/// @param count The number of pulses, including this one.
+	/// @param mean The mean power of each gate, updated.
+	/// @param m2 The sum of squared deviations from the mean, updated.
+	/// @param min The smallest power of each gate, updated.
+	/// @param max The largest power of each gate, updated.
+	void (*welford)(const double* I, const double* Q, int n, long long count,
+			double* mean, double* m2, double* min, double* max);
+
+	/// @return The kernels in use.
+	static const DspKernels& get();
+	/// @return True if the CPU can run the variant for isa.
+	static bool supported(Isa isa);
+	/// @return The most capable variant that the CPU can run.
+	static Isa best();
+	/// Use a particular variant from now on.
+	/// @return False if the CPU cannot run it, in which case
+	/// nothing changes.
+	static bool select(Isa isa);
+	/// Use a variant named as for ASCOPE_ISA from now on.
+	/// @return False if the name is unknown or the CPU cannot run it.
+	static bool select(const std::string& name);
+
+protected:
+	/// @return The table for isa, which may not be runnable here.
+	static const DspKernels& table(Isa isa);
+	/// Find the variant with a name as for ASCOPE_ISA.
+	/// @return False if there is no such variant.
+	static bool lookup(const std::string& name, Isa& isa);
+	/// The table in use, or null until the first get().
+	static const DspKernels* volatile _active;
+};
+
+#endif
@@ -0,0 +1,100 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "FrameHistory.h"
+
+////////////////////////////////////////////////////////
+FrameHistory::FrameHistory(int frames, size_t bytes):
+_maxFrames(frames < 1 ? 1 : frames),
+_maxBytes(bytes),
+_bytes(0),
+_next(0)
+{
+}
+
+////////////////////////////////////////////////////////
+void
+FrameHistory::setLimits(int frames, size_t bytes)
+{
+	_maxFrames = frames < 1 ? 1 : frames;
+	_maxBytes = bytes;
+	trim();
+}
+
+////////////////////////////////////////////////////////
+long long
+FrameHistory::push(ScopeFramePtr frame)
+{
+	size_t size = frameBytes(*frame);
+	_frames.push_back(frame);
+	_sizes.push_back(size);
+	_bytes += size;
+	trim();
+	return _next++;
+}
+
+////////////////////////////////////////////////////////
+ScopeFramePtr
+FrameHistory::frame(long long serial) const
+{
+	if (serial < first() || serial > last()) {
+		return ScopeFramePtr();
+	}
+	return _frames[serial - first()];
+}
+
+////////////////////////////////////////////////////////
+void
+FrameHistory::clear()
+{
+	_frames.clear();
+	_sizes.clear();
+	_bytes = 0;
+}
+
+////////////////////////////////////////////////////////
+void
+FrameHistory::trim()
+{
+	while (_frames.size() > 1 &&
+			((int)_frames.size() > _maxFrames || _bytes > _maxBytes)) {
+		_bytes -= _sizes.front();
+		_frames.pop_front();
+		_sizes.pop_front();
+	}
+}
+
+////////////////////////////////////////////////////////
+size_t
+FrameHistory::frameBytes(const ScopeFrame& frame)
+{
+	const CrossSpectra& cross = frame.cross;
+	return sizeof(ScopeFrame) +
+		sizeof(double)*(frame.I.capacity() + frame.Q.capacity() +
+				frame.spectrum.capacity() + frame.cfarThreshold.capacity() +
+				cross.power1.capacity() + cross.power2.capacity() +
+				cross.cross.capacity() + cross.coherence.capacity() +
+				cross.phase.capacity() + cross.differential.capacity()) +
+		sizeof(float)*frame.profiles.capacity() +
+		sizeof(CfarDetection)*frame.detections.capacity();
+}
@@ -0,0 +1,92 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef FRAMEHISTORYINC_
+#define FRAMEHISTORYINC_
+
+#include <deque>
+#include <cstddef>
+
+#include "ScopeFrame.h"
+
+/**
+ FrameHistory keeps the most recent frames delivered to a view, so
+ that they can be looked at again after the display is frozen. Frames
+ are immutable and shared, so keeping one costs a reference rather
+ than a copy; the history is bounded both by the number of frames and
+ by the memory that they hold, and the oldest frames are released
+ first. Each frame is given a serial number when it is added, which
+ stays valid while frames are added and dropped around it.
+ **/
+class FrameHistory {
+public:
+	/// Constructor
+	/// @param frames The largest number of frames kept.
+	/// @param bytes The largest amount of frame data kept.
+	FrameHistory(int frames = 256, size_t bytes = 64*1024*1024);
+	/// Change the limits, dropping the oldest frames if needed.
+	/// @param frames The largest number of frames kept.
+	/// @param bytes The largest amount of frame data kept.
+	void setLimits(int frames, size_t bytes);
+	/// Add a frame, dropping the oldest frames if it makes the
+	/// history exceed its limits. The newest frame is always kept.
+	/// @param frame The frame.
+	/// @return The serial number of the frame.
+	long long push(ScopeFramePtr frame);
+	/// @return A frame, or a null pointer if it is no longer kept.
+	/// @param serial The serial number of the frame.
+	ScopeFramePtr frame(long long serial) const;
+	/// @return The serial number of the oldest frame kept.
+	long long first() const { return _next - _frames.size(); }
+	/// @return The serial number of the newest frame, or
+	/// first() - 1 if there are none.
+	long long last() const { return _next - 1; }
+	/// @return The number of frames kept.
+	int size() const { return _frames.size(); }
+	/// @return The amount of frame data kept, in bytes.
+	size_t bytes() const { return _bytes; }
+	/// Forget all of the frames. Serial numbers are not reused.
+	void clear();
+	/// @return The memory held by a frame's data, in bytes.
+	/// @param frame The frame.
+	static size_t frameBytes(const ScopeFrame& frame);
+
+protected:
+	/// Drop the oldest frames until the limits are met, keeping
+	/// at least the newest one.
+	void trim();
+	/// The frames, oldest first
+	std::deque<ScopeFramePtr> _frames;
+	/// The size of each frame, from frameBytes()
+	std::deque<size_t> _sizes;
+	/// The largest number of frames kept
+	int _maxFrames;
+	/// The largest amount of frame data kept
+	size_t _maxBytes;
+	/// The amount of frame data kept
+	size_t _bytes;
+	/// The serial number of the next frame
+	long long _next;
+};
+
+#endif
@@ -0,0 +1,92 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "FramePublisher.h"
+
+////////////////////////////////////////////////////////
+FramePublisher::FramePublisher(QObject* parent):
+QObject(parent),
+_published(0)
+{
+}
+
+////////////////////////////////////////////////////////
+FramePublisher::~FramePublisher()
+{
+}
+
+////////////////////////////////////////////////////////
+bool
+FramePublisher::openRing(const std::string& name, int slotCount, int maxValues)
+{
+	QMutexLocker locker(&_mutex);
+	return _ring.create(name, slotCount, maxValues);
+}
+
+////////////////////////////////////////////////////////
+void
+FramePublisher::closeRing()
+{
+	QMutexLocker locker(&_mutex);
+	_ring.unlink();
+	_ring.close();
+}
+
+////////////////////////////////////////////////////////
+unsigned long long
+FramePublisher::published() const
+{
+	QMutexLocker locker(&_mutex);
+	return _published;
+}
+
+////////////////////////////////////////////////////////
+unsigned long long
+FramePublisher::ringDropped() const
+{
+	QMutexLocker locker(&_mutex);
+	return _ring.dropped();
+}
+
+////////////////////////////////////////////////////////
+void
+FramePublisher::publish(ScopeFramePtr frame)
+{
+	if (frame.isNull()) {
+		return;
+	}
+	{
+		// the ring has one writer at a time
+		QMutexLocker locker(&_mutex);
+		_published++;
+		_ring.write(*frame);
+	}
+	emit framePublished(frame);
+}
+
+////////////////////////////////////////////////////////
+void
+FramePublisher::publish(int, ScopeFramePtr frame)
+{
+	publish(frame);
+}
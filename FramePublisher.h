@@ -0,0 +1,108 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef FRAMEPUBLISHERINC_
+#define FRAMEPUBLISHERINC_
+
+#include <QObject>
+#include <QMutex>
+#include <string>
+
+#include "ScopeFrame.h"
+#include "ShmFrameRing.h"
+
+/**
+ FramePublisher hands processed frames to any number of consumers,
+ so that an archiver or alarm logic can use the products that the
+ scope has already computed, rather than computing them again.
+
+ Consumers in the same process connect to framePublished(). The
+ frame is shared, not copied: every consumer receives the same
+ immutable ScopeFrame, which is freed when the last one lets go of
+ it. Consumers in other processes read a shared memory frame ring
+ (see ShmFrameRing.h), which the publisher writes if openRing() has
+ been called; a full ring drops frames rather than holding up the
+ scope.
+
+ @code
+   FramePublisher publisher;
+   publisher.openRing("/ascope_frames", 64, 4096);
+   connect(scope, SIGNAL(frameDisplayed(ScopeFramePtr)),
+           &publisher, SLOT(publish(ScopeFramePtr)));
+   connect(&publisher, SIGNAL(framePublished(ScopeFramePtr)),
+           archiver, SLOT(frameSlot(ScopeFramePtr)));
+ @endcode
+
+ Frames of a particular selection, independent of what the scope
+ shows, can be published by subscribing to AScopeEngine and
+ connecting its frameReady() to publish(int, ScopeFramePtr).
+ publish() may be called from any thread.
+ **/
+class FramePublisher : public QObject {
+	Q_OBJECT
+public:
+	/// Constructor
+	/// @param parent The parent object.
+	FramePublisher(QObject* parent = 0);
+	/// Destructor. The shared memory ring, if any, is unmapped
+	/// but not removed.
+	virtual ~FramePublisher();
+	/// Also publish the frames to a shared memory ring, replacing
+	/// any existing one with the same name.
+	/// @param name The shared memory object name, e.g. "/ascope_frames".
+	/// @param slotCount The number of frames that the ring holds.
+	/// @param maxValues The largest number of spectrum bins or time
+	/// series samples in a frame; larger frames are dropped.
+	/// @return False on failure, with errno set.
+	bool openRing(const std::string& name, int slotCount, int maxValues);
+	/// Stop publishing to the shared memory ring, and remove its name.
+	void closeRing();
+	/// @return The number of frames published.
+	unsigned long long published() const;
+	/// @return The number of frames that the shared memory ring dropped.
+	unsigned long long ringDropped() const;
+
+signals:
+	/// Emitted for each frame published.
+	/// @param frame The frame.
+	void framePublished(ScopeFramePtr frame);
+
+public slots:
+	/// Publish a frame.
+	/// @param frame The frame.
+	void publish(ScopeFramePtr frame);
+	/// Publish a frame delivered by AScopeEngine::frameReady().
+	/// @param id The subscriber id, which is ignored.
+	/// @param frame The frame.
+	void publish(int id, ScopeFramePtr frame);
+
+protected:
+	/// Protects _ring and _published
+	mutable QMutex _mutex;
+	/// The shared memory ring
+	ShmFrameWriter _ring;
+	/// The number of frames published
+	unsigned long long _published;
+};
+
+#endif
@@ -0,0 +1,135 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "GateRing.h"
+
+////////////////////////////////////////////////////////
+GateRing::GateRing(int capacity):
+_head(0),
+_count(0),
+_total(0)
+{
+	setCapacity(capacity);
+}
+
+////////////////////////////////////////////////////////
+GateRing::~GateRing()
+{
+}
+
+////////////////////////////////////////////////////////
+void
+GateRing::setCapacity(int capacity)
+{
+	if (capacity < 0) {
+		capacity = 0;
+	}
+	if (capacity == (int)_I.size()) {
+		return;
+	}
+
+	// keep as many of the most recent samples as will fit
+	std::vector<double> I;
+	std::vector<double> Q;
+	int keep = _count < capacity ? _count : capacity;
+	latest(keep, I, Q);
+
+	_I.assign(capacity, 0.0);
+	_Q.assign(capacity, 0.0);
+	for (int j = 0; j < keep; j++) {
+		_I[j] = I[j];
+		_Q[j] = Q[j];
+	}
+	_count = keep;
+	_head = (capacity == 0 || keep == capacity) ? 0 : keep;
+}
+
+////////////////////////////////////////////////////////
+void
+GateRing::clear()
+{
+	_head = 0;
+	_count = 0;
+	_total = 0;
+}
+
+////////////////////////////////////////////////////////
+bool
+GateRing::latest(int n, std::vector<double>& I, std::vector<double>& Q) const
+{
+	if (n > _count || n < 0) {
+		return false;
+	}
+	I.resize(n);
+	Q.resize(n);
+
+	// copy in at most two pieces: from the start index to the
+	// end of the buffer, then from the beginning of the buffer.
+	int cap = _I.size();
+	int start = ((int)_head - n + cap) % (cap ? cap : 1);
+	int first = cap - start;
+	if (first > n) {
+		first = n;
+	}
+	for (int j = 0; j < first; j++) {
+		I[j] = _I[start + j];
+		Q[j] = _Q[start + j];
+	}
+	for (int j = first; j < n; j++) {
+		I[j] = _I[j - first];
+		Q[j] = _Q[j - first];
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////
+void
+GateRing::push(const double* I, const double* Q, int n)
+{
+	int cap = _I.size();
+	if (cap == 0 || n <= 0) {
+		return;
+	}
+	_total += n;
+	// only the last capacity() samples survive
+	if (n > cap) {
+		I += n - cap;
+		Q += n - cap;
+		n = cap;
+	}
+	// copy in at most two pieces, as for latest()
+	int first = cap - (int)_head;
+	if (first > n) {
+		first = n;
+	}
+	for (int j = 0; j < first; j++) {
+		_I[_head + j] = I[j];
+		_Q[_head + j] = Q[j];
+	}
+	for (int j = first; j < n; j++) {
+		_I[j - first] = I[j];
+		_Q[j - first] = Q[j];
+	}
+	_head = (_head + n) % cap;
+	_count = _count + n < cap ? _count + n : cap;
+}
@@ -0,0 +1,103 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef GATERINGINC_
+#define GATERINGINC_
+
+#include <vector>
+
+/**
+ GateRing is a circular buffer of I and Q samples for one gate.
+ Every pulse is pushed as it arrives, and the most recent
+ capacity() samples are always available. Any number of samples,
+ up to count(), can be copied out, oldest first, so that blocks of
+ different lengths, and successive overlapping blocks, can be taken
+ from the same buffer without waiting for a fresh fill.
+
+ GateRing does no locking; the owner must serialize access.
+ **/
+class GateRing {
+public:
+	/// Constructor
+	/// @param capacity The number of samples retained.
+	GateRing(int capacity = 0);
+	/// Destructor
+	virtual ~GateRing();
+	/// Change the capacity. The most recent samples are kept.
+	/// @param capacity The number of samples retained.
+	void setCapacity(int capacity);
+	/// @return The number of samples retained.
+	int capacity() const { return _I.size(); }
+	/// @return The number of samples available, which is
+	/// at most capacity().
+	int count() const { return _count; }
+	/// @return The total number of samples pushed since
+	/// construction or the last clear().
+	long long total() const { return _total; }
+	/// Discard all samples.
+	void clear();
+	/// Add a sample, overwriting the oldest one if full.
+	/// @param i The I value.
+	/// @param q The Q value.
+	inline void push(double i, double q) {
+		if (_I.empty()) {
+			return;
+		}
+		_I[_head] = i;
+		_Q[_head] = q;
+		if (++_head == _I.size()) {
+			_head = 0;
+		}
+		if (_count < (int)_I.size()) {
+			_count++;
+		}
+		_total++;
+	}
+	/// Add a series of samples, oldest first, overwriting the
+	/// oldest ones if full.
+	/// @param I The I values.
+	/// @param Q The Q values.
+	/// @param n The number of samples.
+	void push(const double* I, const double* Q, int n);
+	/// Copy out the most recent samples, oldest first.
+	/// @param n The number of samples. Must not exceed count().
+	/// @param I The I values are returned here, resized to n.
+	/// @param Q The Q values are returned here, resized to n.
+	/// @return False if fewer than n samples are available, in
+	/// which case nothing is copied.
+	bool latest(int n, std::vector<double>& I, std::vector<double>& Q) const;
+
+protected:
+	/// The I samples
+	std::vector<double> _I;
+	/// The Q samples
+	std::vector<double> _Q;
+	/// The index where the next sample will be written
+	unsigned int _head;
+	/// The number of valid samples
+	int _count;
+	/// The number of samples pushed
+	long long _total;
+};
+
+#endif
@@ -0,0 +1,77 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "GateStats.h"
+#include "DspKernels.h"
+#include <cmath>
+
+////////////////////////////////////////////////////////
+GateStats::GateStats():
+_count(0)
+{
+}
+
+////////////////////////////////////////////////////////
+GateStats::~GateStats()
+{
+}
+
+////////////////////////////////////////////////////////
+void
+GateStats::clear()
+{
+	_count = 0;
+	_mean.clear();
+	_m2.clear();
+	_min.clear();
+	_max.clear();
+}
+
+////////////////////////////////////////////////////////
+void
+GateStats::push(const double* I, const double* Q, int gates)
+{
+	if (gates <= 0) {
+		return;
+	}
+	if (gates != (int)_mean.size()) {
+		_count = 0;
+		_mean.assign(gates, 0.0);
+		_m2.assign(gates, 0.0);
+		_min.assign(gates, HUGE_VAL);
+		_max.assign(gates, 0.0);
+	}
+	_count++;
+	DspKernels::get().welford(I, Q, gates, _count,
+			&_mean[0], &_m2[0], &_min[0], &_max[0]);
+}
+
+////////////////////////////////////////////////////////
+double
+GateStats::variance(int gate) const
+{
+	if (_count < 2 || gate < 0 || gate >= (int)_m2.size()) {
+		return 0.0;
+	}
+	return _m2[gate] / (_count - 1);
+}
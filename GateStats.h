@@ -0,0 +1,84 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef GATESTATSINC_
+#define GATESTATSINC_
+
+#include <vector>
+
+/**
+ GateStats keeps running statistics of the power in every gate of
+ a channel: the mean, variance, minimum and maximum over all of the
+ pulses since the statistics were started. They are updated with
+ Welford's method, which stays accurate over the billions of pulses
+ of a long run, where sums of powers and squared powers would not.
+ A gate that runs hot, saturates or picks up interference stands
+ out in them without any raw data being recorded.
+
+ The statistics start over when the number of gates changes.
+ GateStats does no locking; the owner must serialize access.
+ It is copyable, so that a snapshot can be taken under the owner's
+ lock and examined at leisure.
+ **/
+class GateStats {
+public:
+	/// Constructor
+	GateStats();
+	/// Destructor
+	virtual ~GateStats();
+	/// Add a pulse.
+	/// @param I The I value of each gate.
+	/// @param Q The Q value of each gate.
+	/// @param gates The number of gates.
+	void push(const double* I, const double* Q, int gates);
+	/// Discard the statistics.
+	void clear();
+	/// @return The number of gates.
+	int gates() const { return _mean.size(); }
+	/// @return The number of pulses since the statistics started.
+	long long count() const { return _count; }
+	/// @return The mean power of each gate.
+	const std::vector<double>& mean() const { return _mean; }
+	/// @return The smallest power seen in each gate.
+	const std::vector<double>& min() const { return _min; }
+	/// @return The largest power seen in each gate.
+	const std::vector<double>& max() const { return _max; }
+	/// @return The variance of the power in a gate, or zero if
+	/// fewer than two pulses have been seen.
+	/// @param gate The gate.
+	double variance(int gate) const;
+
+protected:
+	/// The number of pulses
+	long long _count;
+	/// The mean power of each gate
+	std::vector<double> _mean;
+	/// The sum of squared deviations from the mean of each gate
+	std::vector<double> _m2;
+	/// The smallest power of each gate
+	std::vector<double> _min;
+	/// The largest power of each gate
+	std::vector<double> _max;
+};
+
+#endif
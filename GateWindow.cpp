@@ -0,0 +1,62 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "GateWindow.h"
+
+////////////////////////////////////////////////////////
+GateWindow::GateWindow(int first, int last, int step):
+start(first < 0 ? 0 : first),
+stop(last < 0 ? -1 : last),
+stride(step < 1 ? 1 : step)
+{
+}
+
+////////////////////////////////////////////////////////
+bool
+GateWindow::operator==(const GateWindow& other) const
+{
+	return start == other.start && stop == other.stop && stride == other.stride;
+}
+
+////////////////////////////////////////////////////////
+int
+GateWindow::count(int gates) const
+{
+	int last = (stop < 0 || stop >= gates) ? gates - 1 : stop;
+	if (start > last) {
+		return 0;
+	}
+	return (last - start)/stride + 1;
+}
+
+////////////////////////////////////////////////////////
+int
+GateWindow::index(int g, int gates) const
+{
+	if (g <= start) {
+		return 0;
+	}
+	int i = (g - start + stride - 1)/stride;
+	int n = count(gates);
+	return i < n ? i : n;
+}
@@ -0,0 +1,64 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef GATEWINDOWINC_
+#define GATEWINDOWINC_
+
+/**
+ GateWindow selects the gates of interest along the beam: every
+ stride'th gate from start up to and including stop. Along the beam,
+ only these gates are gathered, kept in the range-time profiles and
+ the gate statistics, and displayed, so that the work follows the
+ region of interest rather than the full range.
+ **/
+class GateWindow {
+public:
+	/// Constructor. The default window takes every gate.
+	/// @param start The first gate.
+	/// @param stop The last gate, or -1 for the last gate of the data.
+	/// @param stride The spacing of the gates taken; at least 1.
+	GateWindow(int start = 0, int stop = -1, int stride = 1);
+	bool operator==(const GateWindow& other) const;
+	bool operator!=(const GateWindow& other) const { return !(*this == other); }
+	/// @return True if the window takes every gate.
+	bool all() const { return start == 0 && stop < 0 && stride == 1; }
+	/// @return The number of gates taken from a pulse.
+	/// @param gates The number of gates in the pulse.
+	int count(int gates) const;
+	/// @return The gate number of a gate taken.
+	/// @param i The index of the gate among those taken.
+	int gate(int i) const { return start + i*stride; }
+	/// @return The index among the gates taken of the nearest one
+	/// at or after a gate, which may be count() if there is none.
+	/// @param g The gate number.
+	/// @param gates The number of gates in the pulse.
+	int index(int g, int gates) const;
+	/// The first gate
+	int start;
+	/// The last gate, or -1 for the last gate of the data
+	int stop;
+	/// The spacing of the gates taken
+	int stride;
+};
+
+#endif
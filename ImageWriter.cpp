@@ -0,0 +1,59 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "ImageWriter.h"
+#include <QFileInfo>
+#include <iostream>
+
+////////////////////////////////////////////////////////
+ImageWriter::ImageWriter(const QImage& image, const QString& fileName, QAtomicInt* inFlight):
+_image(image),
+_fileName(fileName),
+_inFlight(inFlight)
+{
+	setAutoDelete(true);
+}
+
+////////////////////////////////////////////////////////
+ImageWriter::~ImageWriter()
+{
+}
+
+////////////////////////////////////////////////////////
+void
+ImageWriter::run()
+{
+	const char* format = 0;
+	if (QFileInfo(_fileName).suffix().isEmpty()) {
+		format = "PNG";
+	}
+
+	if (!_image.save(_fileName, format)) {
+		std::cerr << "AScope: unable to save image to " <<
+			_fileName.toStdString() << std::endl;
+	}
+
+	if (_inFlight) {
+		_inFlight->deref();
+	}
+}
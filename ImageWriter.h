@@ -0,0 +1,65 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef IMAGEWRITERINC_
+#define IMAGEWRITERINC_
+
+#include <QRunnable>
+#include <QImage>
+#include <QString>
+#include <QAtomicInt>
+
+/**
+ ImageWriter encodes a captured image and writes it to disk. It is
+ meant to be handed to a QThreadPool, so that the (slow) PNG encoding
+ and file i/o take place away from the GUI thread. The image is
+ captured by the caller; QImage is implicitly shared, so handing it
+ to the writer does not copy the pixels.
+
+ An optional counter is decremented when the write has completed,
+ allowing the owner to keep track of the number of writes in flight
+ and to skip new captures if the disk cannot keep up.
+ **/
+class ImageWriter : public QRunnable {
+public:
+	/// Constructor
+	/// @param image The image to be saved.
+	/// @param fileName The destination file. The format is deduced
+	/// from the suffix, defaulting to PNG.
+	/// @param inFlight If not null, this counter will be decremented
+	/// when the write is finished (successfully or not).
+	ImageWriter(const QImage& image, const QString& fileName, QAtomicInt* inFlight = 0);
+	/// Destructor
+	virtual ~ImageWriter();
+	/// Encode and write the image.
+	virtual void run();
+
+protected:
+	/// The image to write
+	QImage _image;
+	/// The destination file name
+	QString _fileName;
+	/// The in flight counter, may be null
+	QAtomicInt* _inFlight;
+};
+#endif
@@ -0,0 +1,75 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "LatencyStats.h"
+#include <algorithm>
+
+////////////////////////////////////////////////////////
+LatencyStats::LatencyStats(int window):
+_window(window > 0 ? window : 1),
+_count(0)
+{
+}
+
+////////////////////////////////////////////////////////
+void
+LatencyStats::add(double secs)
+{
+	if ((int)_values.size() < _window) {
+		_values.push_back(secs);
+	} else {
+		_values[_count % _window] = secs;
+	}
+	_count++;
+}
+
+////////////////////////////////////////////////////////
+double
+LatencyStats::percentile(double p) const
+{
+	if (_values.empty()) {
+		return 0.0;
+	}
+	std::vector<double> v(_values);
+	size_t i = (size_t)(std::min(std::max(p, 0.0), 1.0)*(v.size() - 1) + 0.5);
+	std::nth_element(v.begin(), v.begin() + i, v.end());
+	return v[i];
+}
+
+////////////////////////////////////////////////////////
+double
+LatencyStats::last() const
+{
+	if (_values.empty()) {
+		return 0.0;
+	}
+	return _values[(_count - 1) % _window];
+}
+
+////////////////////////////////////////////////////////
+void
+LatencyStats::clear()
+{
+	_values.clear();
+	_count = 0;
+}
@@ -0,0 +1,65 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef LATENCYSTATSINC_
+#define LATENCYSTATSINC_
+
+#include <vector>
+
+/**
+ LatencyStats keeps the most recent values of a latency, and gives
+ their percentiles, so that the typical and the worst delays of a
+ stage can be told apart. The values are kept in a circular window;
+ percentiles are computed on demand, which costs a copy and a
+ partial sort of the window.
+ **/
+class LatencyStats {
+public:
+	/// Constructor
+	/// @param window The number of recent values kept.
+	LatencyStats(int window = 512);
+	/// Add a value.
+	/// @param secs The latency, in seconds.
+	void add(double secs);
+	/// @return A percentile of the recent values, or 0 if there are none.
+	/// @param p The percentile, as a fraction: 0.5 for the median.
+	double percentile(double p) const;
+	/// @return The most recent value, or 0 if there is none.
+	double last() const;
+	/// @return The number of values in the window.
+	int size() const { return _values.size(); }
+	/// @return The number of values added since the last clear().
+	long long count() const { return _count; }
+	/// Forget all of the values.
+	void clear();
+
+protected:
+	/// The recent values, circular once full
+	std::vector<double> _values;
+	/// The largest number of values kept
+	int _window;
+	/// The number of values added
+	long long _count;
+};
+
+#endif
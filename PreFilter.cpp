@@ -0,0 +1,394 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "PreFilter.h"
+
+#include <cmath>
+#include <sstream>
+#include <time.h>
+
+namespace {
+	/// @return A monotonic time, in seconds.
+	double now() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + 1.0e-9*ts.tv_nsec;
+	}
+}
+
+////////////////////////////////////////////////////////
+PreFilterSpec::PreFilterSpec():
+removeMean(false),
+regressionOrder(-1),
+notch(false),
+notchFreq(0.0),
+notchRadius(0.95),
+decimation(1)
+{
+}
+
+////////////////////////////////////////////////////////
+bool
+PreFilterSpec::operator<(const PreFilterSpec& o) const
+{
+	if (removeMean != o.removeMean)
+		return removeMean < o.removeMean;
+	if (regressionOrder != o.regressionOrder)
+		return regressionOrder < o.regressionOrder;
+	if (notch != o.notch)
+		return notch < o.notch;
+	if (notch && notchFreq != o.notchFreq)
+		return notchFreq < o.notchFreq;
+	if (notch && notchRadius != o.notchRadius)
+		return notchRadius < o.notchRadius;
+	return decimation < o.decimation;
+}
+
+////////////////////////////////////////////////////////
+bool
+PreFilterSpec::operator==(const PreFilterSpec& o) const
+{
+	return !(*this < o) && !(o < *this);
+}
+
+////////////////////////////////////////////////////////
+bool
+PreFilterSpec::empty() const
+{
+	return !removeMean && regressionOrder < 0 && !notch && decimation <= 1;
+}
+
+////////////////////////////////////////////////////////
+PreFilter::PreFilter()
+{
+}
+
+////////////////////////////////////////////////////////
+PreFilter::~PreFilter()
+{
+}
+
+////////////////////////////////////////////////////////
+void
+PreFilter::setup(int)
+{
+}
+
+////////////////////////////////////////////////////////
+std::string
+MeanRemovalFilter::name() const
+{
+	return "mean removal";
+}
+
+////////////////////////////////////////////////////////
+void
+MeanRemovalFilter::apply(double* I, double* Q, int& n)
+{
+	if (n <= 0) {
+		return;
+	}
+	double sumI = 0.0;
+	double sumQ = 0.0;
+	for (int j = 0; j < n; j++) {
+		sumI += I[j];
+		sumQ += Q[j];
+	}
+	double mI = sumI/n;
+	double mQ = sumQ/n;
+	for (int j = 0; j < n; j++) {
+		I[j] -= mI;
+		Q[j] -= mQ;
+	}
+}
+
+////////////////////////////////////////////////////////
+RegressionFilter::RegressionFilter(int order):
+_order(order < 0 ? 0 : order),
+_n(0)
+{
+}
+
+////////////////////////////////////////////////////////
+std::string
+RegressionFilter::name() const
+{
+	std::ostringstream s;
+	s << "regression order " << _order;
+	return s.str();
+}
+
+////////////////////////////////////////////////////////
+void
+RegressionFilter::setup(int n)
+{
+	_n = n;
+	int rows = _order + 1;
+	_basis.assign(rows*n, 0.0);
+	if (n == 0) {
+		return;
+	}
+
+	// Build orthonormal polynomials over the sample positions by
+	// Gram-Schmidt on 1, x, x^2 ..., with x scaled to [-1, 1] to keep
+	// the powers well conditioned.
+	for (int k = 0; k < rows; k++) {
+		double* p = &_basis[k*n];
+		for (int j = 0; j < n; j++) {
+			double x = (n > 1) ? (2.0*j/(n - 1) - 1.0) : 0.0;
+			p[j] = pow(x, k);
+		}
+		// twice, for numerical orthogonality
+		for (int pass = 0; pass < 2; pass++) {
+			for (int m = 0; m < k; m++) {
+				const double* b = &_basis[m*n];
+				double dot = 0.0;
+				for (int j = 0; j < n; j++) {
+					dot += p[j]*b[j];
+				}
+				for (int j = 0; j < n; j++) {
+					p[j] -= dot*b[j];
+				}
+			}
+		}
+		double norm = 0.0;
+		for (int j = 0; j < n; j++) {
+			norm += p[j]*p[j];
+		}
+		norm = sqrt(norm);
+		for (int j = 0; j < n; j++) {
+			p[j] = (norm > 0.0) ? p[j]/norm : 0.0;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+RegressionFilter::apply(double* I, double* Q, int& n)
+{
+	if (n != _n) {
+		setup(n);
+	}
+	// project onto each basis polynomial and subtract
+	for (int k = 0; k <= _order; k++) {
+		const double* b = &_basis[k*n];
+		double cI = 0.0;
+		double cQ = 0.0;
+		for (int j = 0; j < n; j++) {
+			cI += I[j]*b[j];
+			cQ += Q[j]*b[j];
+		}
+		for (int j = 0; j < n; j++) {
+			I[j] -= cI*b[j];
+			Q[j] -= cQ*b[j];
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+NotchFilter::NotchFilter(double freq, double radius):
+_c(cos(2.0*M_PI*freq)),
+_s(sin(2.0*M_PI*freq)),
+_r(radius)
+{
+}
+
+////////////////////////////////////////////////////////
+std::string
+NotchFilter::name() const
+{
+	std::ostringstream s;
+	s << "notch " << atan2(_s, _c)/(2.0*M_PI) << " fs";
+	return s.str();
+}
+
+////////////////////////////////////////////////////////
+void
+NotchFilter::apply(double* I, double* Q, int& n)
+{
+	if (n <= 0) {
+		return;
+	}
+	// y[k] = x[k] - e^jw x[k-1] + r e^jw y[k-1]
+	//
+	// The state is primed as if a tone at the notch frequency had
+	// been going on forever, so a block dominated by that tone
+	// does not start with a transient.
+	double xI = _c*I[0] + _s*Q[0];
+	double xQ = _c*Q[0] - _s*I[0];
+	double yI = 0.0;
+	double yQ = 0.0;
+	for (int j = 0; j < n; j++) {
+		double inI = I[j];
+		double inQ = Q[j];
+		double outI = inI - (_c*xI - _s*xQ) + _r*(_c*yI - _s*yQ);
+		double outQ = inQ - (_c*xQ + _s*xI) + _r*(_c*yQ + _s*yI);
+		I[j] = outI;
+		Q[j] = outQ;
+		xI = inI;
+		xQ = inQ;
+		yI = outI;
+		yQ = outQ;
+	}
+}
+
+////////////////////////////////////////////////////////
+DecimationFilter::DecimationFilter(int factor):
+_factor(factor < 1 ? 1 : factor)
+{
+}
+
+////////////////////////////////////////////////////////
+std::string
+DecimationFilter::name() const
+{
+	std::ostringstream s;
+	s << "decimate by " << _factor;
+	return s.str();
+}
+
+////////////////////////////////////////////////////////
+void
+DecimationFilter::apply(double* I, double* Q, int& n)
+{
+	if (_factor == 1) {
+		return;
+	}
+	// output j only reads inputs at or after j, so this can run in place
+	int out = n/_factor;
+	double scale = 1.0/_factor;
+	for (int j = 0; j < out; j++) {
+		const double* pI = I + j*_factor;
+		const double* pQ = Q + j*_factor;
+		double sumI = 0.0;
+		double sumQ = 0.0;
+		for (int k = 0; k < _factor; k++) {
+			sumI += pI[k];
+			sumQ += pQ[k];
+		}
+		I[j] = sumI*scale;
+		Q[j] = sumQ*scale;
+	}
+	n = out;
+}
+
+////////////////////////////////////////////////////////
+PreFilterChain::PreFilterChain(const PreFilterSpec& spec)
+{
+	setSpec(spec);
+}
+
+////////////////////////////////////////////////////////
+PreFilterChain::~PreFilterChain()
+{
+	clear();
+}
+
+////////////////////////////////////////////////////////
+void
+PreFilterChain::setSpec(const PreFilterSpec& spec)
+{
+	clear();
+	_spec = spec;
+	if (spec.removeMean) {
+		append(new MeanRemovalFilter);
+	}
+	if (spec.regressionOrder >= 0) {
+		append(new RegressionFilter(spec.regressionOrder));
+	}
+	if (spec.notch) {
+		append(new NotchFilter(spec.notchFreq, spec.notchRadius));
+	}
+	if (spec.decimation > 1) {
+		append(new DecimationFilter(spec.decimation));
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+PreFilterChain::append(PreFilter* stage)
+{
+	_stages.push_back(stage);
+	_timing.push_back(StageTiming());
+	_timing.back().name = stage->name();
+	_lengths.push_back(-1);
+}
+
+////////////////////////////////////////////////////////
+void
+PreFilterChain::clear()
+{
+	for (unsigned int i = 0; i < _stages.size(); i++) {
+		delete _stages[i];
+	}
+	_stages.clear();
+	_timing.clear();
+	_lengths.clear();
+	_spec = PreFilterSpec();
+}
+
+////////////////////////////////////////////////////////
+void
+PreFilterChain::apply(std::vector<double>& I, std::vector<double>& Q)
+{
+	int n = I.size() < Q.size() ? I.size() : Q.size();
+	if (_stages.empty() || n == 0) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < _stages.size(); i++) {
+		// set up the stage for a new block length
+		if (n != _lengths[i]) {
+			_stages[i]->setup(n);
+			_lengths[i] = n;
+		}
+		double start = now();
+		_stages[i]->apply(&I[0], &Q[0], n);
+		double secs = now() - start;
+		StageTiming& t = _timing[i];
+		t.calls++;
+		t.lastSecs = secs;
+		t.totalSecs += secs;
+	}
+
+	I.resize(n);
+	Q.resize(n);
+}
+
+////////////////////////////////////////////////////////
+std::vector<PreFilterChain::StageTiming>
+PreFilterChain::timing() const
+{
+	return _timing;
+}
+
+////////////////////////////////////////////////////////
+void
+PreFilterChain::resetTiming()
+{
+	for (unsigned int i = 0; i < _timing.size(); i++) {
+		std::string name = _timing[i].name;
+		_timing[i] = StageTiming();
+		_timing[i].name = name;
+	}
+}
@@ -0,0 +1,208 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef PREFILTERINC_
+#define PREFILTERINC_
+
+#include <vector>
+#include <string>
+
+/**
+ PreFilterSpec describes the conditioning to be applied to a block
+ of I and Q samples before the power spectrum is computed. The
+ stages are applied in a fixed order: mean removal, polynomial
+ regression clutter filter, notch, decimation. It is a value type,
+ so that it can be part of a selection and compared.
+ **/
+class PreFilterSpec {
+public:
+	PreFilterSpec();
+	bool operator<(const PreFilterSpec& other) const;
+	bool operator==(const PreFilterSpec& other) const;
+	/// @return True if no stage is enabled.
+	bool empty() const;
+	/// Set true to subtract the block mean.
+	bool removeMean;
+	/// The order of the polynomial regression clutter filter,
+	/// or -1 for none. The best fit polynomial of this order
+	/// is subtracted from the block.
+	int regressionOrder;
+	/// Set true to apply the notch filter.
+	bool notch;
+	/// The notch frequency, as a fraction of the sample rate.
+	double notchFreq;
+	/// The notch pole radius, between 0 and 1. Values closer
+	/// to one give a narrower notch.
+	double notchRadius;
+	/// The integer decimation factor, 1 for none.
+	int decimation;
+};
+
+/**
+ A PreFilter is one stage of a PreFilterChain. A stage works in
+ place on the I and Q buffers. Anything that depends only on the
+ block length, such as coefficient tables, is computed in setup(),
+ so that apply() does not allocate.
+ **/
+class PreFilter {
+public:
+	PreFilter();
+	virtual ~PreFilter();
+	/// @return The stage name, for timing reports.
+	virtual std::string name() const = 0;
+	/// Prepare for blocks of a given length. Called by the chain
+	/// before apply() whenever the stage's input length changes.
+	/// @param n The number of samples that apply() will be given.
+	virtual void setup(int n);
+	/// Filter a block in place.
+	/// @param I The I samples.
+	/// @param Q The Q samples.
+	/// @param n The number of samples. A stage that changes the
+	/// length, such as decimation, sets the new length here.
+	virtual void apply(double* I, double* Q, int& n) = 0;
+};
+
+/// Subtract the mean from the block.
+class MeanRemovalFilter : public PreFilter {
+public:
+	virtual std::string name() const;
+	virtual void apply(double* I, double* Q, int& n);
+};
+
+/// Subtract the least squares polynomial fit from the block. This is
+/// the regression clutter filter: it removes slowly varying clutter
+/// with less loss of the near zero velocity signal than a notch.
+class RegressionFilter : public PreFilter {
+public:
+	/// @param order The polynomial order.
+	RegressionFilter(int order);
+	virtual std::string name() const;
+	virtual void setup(int n);
+	virtual void apply(double* I, double* Q, int& n);
+protected:
+	/// The polynomial order
+	int _order;
+	/// The block length that _basis was built for
+	int _n;
+	/// Orthonormal polynomials over the block, _order+1
+	/// rows of _n values.
+	std::vector<double> _basis;
+};
+
+/// A single complex pole/zero notch. The zero is on the unit circle
+/// at the notch frequency, with the pole at the same angle and
+/// a smaller radius. Being complex, it removes only the selected
+/// frequency and not its mirror image.
+class NotchFilter : public PreFilter {
+public:
+	/// @param freq The notch frequency, as a fraction of the sample rate.
+	/// @param radius The pole radius.
+	NotchFilter(double freq, double radius);
+	virtual std::string name() const;
+	virtual void apply(double* I, double* Q, int& n);
+protected:
+	/// cos and sin of the notch angle
+	double _c;
+	double _s;
+	/// The pole radius
+	double _r;
+};
+
+/// Average and decimate by an integer factor. The averaging is
+/// a simple boxcar anti-alias filter.
+class DecimationFilter : public PreFilter {
+public:
+	/// @param factor The decimation factor.
+	DecimationFilter(int factor);
+	virtual std::string name() const;
+	virtual void apply(double* I, double* Q, int& n);
+protected:
+	/// The decimation factor
+	int _factor;
+};
+
+/**
+ PreFilterChain runs a sequence of PreFilter stages on a block, and
+ keeps the time spent in each one. Like SpectrumCalc, it has no
+ dependency on the display, and an instance must only be used by one
+ thread at a time.
+ **/
+class PreFilterChain {
+public:
+	/// The timing for one stage.
+	class StageTiming {
+	public:
+		StageTiming(): calls(0), totalSecs(0.0), lastSecs(0.0) {}
+		/// The stage name
+		std::string name;
+		/// The number of blocks processed
+		long long calls;
+		/// The total time spent, in seconds
+		double totalSecs;
+		/// The time spent on the last block, in seconds
+		double lastSecs;
+	};
+
+	/// Constructor
+	/// @param spec The stages to create.
+	PreFilterChain(const PreFilterSpec& spec = PreFilterSpec());
+	/// Destructor
+	virtual ~PreFilterChain();
+	/// Replace the stages.
+	/// @param spec The stages to create.
+	void setSpec(const PreFilterSpec& spec);
+	/// @return The spec the stages were built from.
+	const PreFilterSpec& spec() const { return _spec; }
+	/// Append a stage. The chain takes ownership.
+	/// @param stage The stage.
+	void append(PreFilter* stage);
+	/// Remove all of the stages.
+	void clear();
+	/// @return The number of stages.
+	int size() const { return _stages.size(); }
+	/// Filter a block in place. The vectors are shrunk if the
+	/// chain decimates; they are never reallocated.
+	/// @param I The I samples.
+	/// @param Q The Q samples.
+	void apply(std::vector<double>& I, std::vector<double>& Q);
+	/// @return The timing for each stage, in chain order.
+	std::vector<StageTiming> timing() const;
+	/// Zero the timing counters.
+	void resetTiming();
+
+protected:
+	/// The stages
+	std::vector<PreFilter*> _stages;
+	/// The timing, one per stage
+	std::vector<StageTiming> _timing;
+	/// The input length that each stage was set up for
+	std::vector<int> _lengths;
+	/// The spec that the stages were built from
+	PreFilterSpec _spec;
+
+private:
+	PreFilterChain(const PreFilterChain&);
+	PreFilterChain& operator=(const PreFilterChain&);
+};
+
+#endif
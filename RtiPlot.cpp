@@ -0,0 +1,180 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "RtiPlot.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <algorithm>
+
+////////////////////////////////////////////////////////
+RtiPlot::RtiPlot(QWidget* parent):
+QWidget(parent),
+_next(0),
+_gates(0),
+_minDb(-80.0),
+_maxDb(40.0)
+{
+	// every pixel is painted from the image
+	setAttribute(Qt::WA_OpaquePaintEvent);
+	setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
+	setMinimumSize(600, 600);
+
+	// blue through cyan, green and yellow to red
+	const int n = 256;
+	_colors.resize(n);
+	for (int i = 0; i < n; i++) {
+		double x = 4.0*i/(n - 1);
+		double r = std::min(1.0, std::max(0.0, std::min(x - 1.5, 4.5 - x)));
+		double g = std::min(1.0, std::max(0.0, std::min(x - 0.5, 3.5 - x)));
+		double b = std::min(1.0, std::max(0.0, std::min(x + 0.5, 2.5 - x)));
+		_colors[i] = qRgb(int(255*r), int(255*g), int(255*b));
+	}
+}
+
+////////////////////////////////////////////////////////
+RtiPlot::~RtiPlot()
+{
+}
+
+////////////////////////////////////////////////////////
+void
+RtiPlot::setRange(double minDb, double maxDb)
+{
+	if (maxDb <= minDb) {
+		maxDb = minDb + 1.0;
+	}
+	_minDb = minDb;
+	_maxDb = maxDb;
+}
+
+////////////////////////////////////////////////////////
+void
+RtiPlot::clear()
+{
+	_image.fill(qRgb(0, 0, 0));
+	_next = 0;
+	update();
+}
+
+////////////////////////////////////////////////////////
+void
+RtiPlot::resizeEvent(QResizeEvent* event)
+{
+	// the beams are not kept, so a resize starts over
+	_image = QImage(event->size(), QImage::Format_RGB32);
+	_image.fill(qRgb(0, 0, 0));
+	_next = 0;
+	mapRows();
+}
+
+////////////////////////////////////////////////////////
+void
+RtiPlot::mapRows()
+{
+	// With fewer gates than rows, neighbouring rows start on the
+	// same gate, and addProfiles() repeats it.
+	int rows = _image.height();
+	_rowStart.resize(rows + 1);
+	for (int r = 0; r <= rows; r++) {
+		_rowStart[r] = rows > 0 ? (int)((long long)r*_gates/rows) : 0;
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+RtiPlot::addProfiles(const float* profiles, int count, int gates)
+{
+	int width = _image.width();
+	int rows = _image.height();
+	if (width == 0 || rows == 0 || count <= 0 || gates <= 0) {
+		return;
+	}
+	if (gates != _gates) {
+		_gates = gates;
+		mapRows();
+	}
+
+	// only the newest beams fit
+	if (count > width) {
+		profiles += (size_t)(count - width)*gates;
+		count = width;
+	}
+
+	double scale = (_colors.size() - 1)/(_maxDb - _minDb);
+	int top = _colors.size() - 1;
+	QRgb* bits = reinterpret_cast<QRgb*>(_image.bits());
+	int stride = _image.bytesPerLine()/sizeof(QRgb);
+
+	for (int p = 0; p < count; p++) {
+		const float* profile = profiles + (size_t)p*gates;
+		// row 0 of the image is at the top, and the farthest range
+		QRgb* pixel = bits + (size_t)(rows - 1)*stride + _next;
+		for (int r = 0; r < rows; r++) {
+			int g = _rowStart[r];
+			int end = std::max(g + 1, _rowStart[r+1]);
+			float peak = profile[g];
+			for (g++; g < end; g++) {
+				if (profile[g] > peak) {
+					peak = profile[g];
+				}
+			}
+			int c = (int)((peak - _minDb)*scale);
+			if (c < 0) {
+				c = 0;
+			} else if (c > top) {
+				c = top;
+			}
+			*pixel = _colors[c];
+			pixel -= stride;
+		}
+		_next = (_next + 1) % width;
+	}
+
+	// move the old columns over; only the new ones are painted
+	scroll(-count, 0);
+}
+
+////////////////////////////////////////////////////////
+void
+RtiPlot::paintEvent(QPaintEvent* event)
+{
+	QPainter painter(this);
+	int width = _image.width();
+	if (width == 0) {
+		return;
+	}
+
+	// The newest column is at the right edge, so widget column x
+	// shows image column (_next + x) % width. Draw the exposed
+	// columns in at most two runs, either side of the wrap.
+	QRect rect = event->rect() & QRect(0, 0, width, _image.height());
+	int x = rect.left();
+	while (x <= rect.right()) {
+		int column = (_next + x) % width;
+		int run = std::min(rect.right() - x + 1, width - column);
+		painter.drawImage(QRect(x, rect.top(), run, rect.height()),
+				_image, QRect(column, rect.top(), run, rect.height()));
+		x += run;
+	}
+}
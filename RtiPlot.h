@@ -0,0 +1,93 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef RTIPLOTINC_
+#define RTIPLOTINC_
+
+#include <QWidget>
+#include <QImage>
+#include <vector>
+
+/**
+ RtiPlot is a range-time intensity display: each beam's power profile
+ is one column, with range increasing upwards, and the columns scroll
+ to the left as new beams arrive.
+
+ The image is allocated once for the size of the widget and used as
+ a circular buffer of columns; adding a beam writes just its column.
+ The widget contents are shifted with QWidget::scroll(), so only the
+ strip of new columns is painted. When there are more gates than
+ pixel rows, the gates are decimated to the rows, keeping the peak
+ of the gates that fall in each row so that point targets are not
+ lost.
+ **/
+class RtiPlot : public QWidget {
+	Q_OBJECT
+public:
+	/// Constructor
+	/// @param parent The parent widget.
+	RtiPlot(QWidget* parent = 0);
+	/// Destructor
+	virtual ~RtiPlot();
+	/// Add beams to the display, oldest first.
+	/// @param profiles count profiles of gates values each, in dB.
+	/// @param count The number of profiles.
+	/// @param gates The number of gates in each profile.
+	void addProfiles(const float* profiles, int count, int gates);
+	/// Set the power range covered by the color scale. The beams
+	/// already displayed keep their colors.
+	/// @param minDb The power at the bottom of the scale, in dB.
+	/// @param maxDb The power at the top of the scale, in dB.
+	void setRange(double minDb, double maxDb);
+	/// @return The power at the bottom of the color scale, in dB.
+	double minDb() const { return _minDb; }
+	/// @return The power at the top of the color scale, in dB.
+	double maxDb() const { return _maxDb; }
+
+public slots:
+	/// Blank the display.
+	void clear();
+
+protected:
+	virtual void paintEvent(QPaintEvent* event);
+	virtual void resizeEvent(QResizeEvent* event);
+	/// Work out which gates go into each pixel row.
+	void mapRows();
+	/// The display, one column per beam, circular
+	QImage _image;
+	/// The image column that the next beam goes into
+	int _next;
+	/// The number of gates that _rowStart was worked out for
+	int _gates;
+	/// The first gate of each pixel row, from the bottom,
+	/// with an extra entry for the end of the last row
+	std::vector<int> _rowStart;
+	/// The color scale
+	std::vector<QRgb> _colors;
+	/// The power at the bottom of the color scale, in dB
+	double _minDb;
+	/// The power at the top of the color scale, in dB
+	double _maxDb;
+};
+
+#endif
@@ -0,0 +1,152 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef SCOPEFRAMEINC_
+#define SCOPEFRAMEINC_
+
+#include <vector>
+#include <QSharedPointer>
+#include <QMetaType>
+
+#include "PreFilter.h"
+#include "SpectrumCalc.h"
+#include "Cfar.h"
+#include "GateWindow.h"
+
+/**
+ A ScopeFrame holds the results of processing one block of data
+ for one channel: the time series that was analyzed and, if it
+ was asked for, the power spectrum. A frame is created by
+ AScopeEngine and then delivered, unmodified, to every subscriber
+ whose selection it satisfies. Frames are passed around as
+ ScopeFramePtr, so that delivering a frame to several views
+ does not copy the data.
+ **/
+class ScopeFrame {
+public:
+	ScopeFrame():
+		channel(0),
+		gate(0),
+		alongBeam(false),
+		gates(0),
+		blockSize(0),
+		window(false),
+		zoom(1),
+		zoomCenterHz(0.0),
+		triggered(false),
+		triggerIndex(0),
+		pairChannel(-1),
+		sampleRateHz(0.0),
+		profileCount(0),
+		zeroMoment(0.0),
+		spectrumZeroMoment(0.0),
+		timestamp(0.0),
+		queueSecs(0.0),
+		processingSecs(0.0),
+		readyTime(0.0)
+	{}
+	/// The channel id
+	int channel;
+	/// The gate, if not along beam
+	int gate;
+	/// True if the time series was taken along the beam
+	bool alongBeam;
+	/// The number of gates in the data stream. For a range-time
+	/// frame, the number of gates in each profile.
+	int gates;
+	/// Along the beam, the gates that I and Q, the profiles and
+	/// cfarThreshold hold
+	GateWindow gateWindow;
+	/// The fft block size
+	int blockSize;
+	/// True if the hamming window was applied to the spectrum
+	bool window;
+	/// The spectrum zoom factor. The spectrum covers
+	/// sampleRateHz/zoom, centered on zoomCenterHz.
+	int zoom;
+	/// The center frequency of a zoomed spectrum, in Hz
+	double zoomCenterHz;
+	/// The conditioning that was applied to I and Q
+	PreFilterSpec preFilter;
+	/// True if the block was captured on a trigger
+	bool triggered;
+	/// The index in I and Q of the sample that fired the trigger
+	int triggerIndex;
+	/// For a two channel selection, the second channel, else -1
+	int pairChannel;
+	/// The sample rate of I and Q, in Hz. This is the data
+	/// stream rate divided by any pre-filter decimation.
+	double sampleRateHz;
+	/// The I time series
+	std::vector<double> I;
+	/// The Q time series
+	std::vector<double> Q;
+	/// The power spectrum, in dB, with zero frequency in the
+	/// center. Empty if the spectrum was not computed.
+	std::vector<double> spectrum;
+	/// For a range-time selection, the power profiles of the beams
+	/// since the last frame, oldest first: profileCount rows of
+	/// gates values, in dB. I and Q are then empty.
+	std::vector<float> profiles;
+	/// The number of profiles
+	int profileCount;
+	/// For a two channel selection, the products of the two
+	/// channels at the gate. spectrum is then the first channel's
+	/// power spectrum, averaged over the same segments.
+	CrossSpectra cross;
+	/// Along the beam, the target detection that was applied
+	CfarSpec cfar;
+	/// The targets found along the beam, if cfar is enabled
+	CfarDetections detections;
+	/// The detection threshold of each gate, in dB, if cfar is enabled
+	std::vector<double> cfarThreshold;
+	/// The mean power of the time series, in dB
+	double zeroMoment;
+	/// The zero moment computed from the spectrum, in dB.
+	/// Only valid if the spectrum was computed.
+	double spectrumZeroMoment;
+	/// The higher moments of the spectrum, with the frequencies
+	/// in Hz. Only valid if the spectrum was computed.
+	SpectralMoments moments;
+	/// The acquisition time of the newest item in the frame's
+	/// channel, from AScope::TimeSeries::timestamp, or 0 if unknown
+	double timestamp;
+	/// The time that item waited in the engine before it was
+	/// ingested, in seconds
+	double queueSecs;
+	/// The time the engine took to make this frame, in seconds
+	double processingSecs;
+	/// When the frame was finished, on the engine's monotonic
+	/// clock, in seconds; the difference from the time it is used
+	/// is the delivery delay
+	double readyTime;
+};
+
+/// Frames are immutable once published, and shared by reference.
+typedef QSharedPointer<const ScopeFrame> ScopeFramePtr;
+
+Q_DECLARE_METATYPE(ScopeFramePtr)
+Q_DECLARE_METATYPE(CfarDetections)
+Q_DECLARE_METATYPE(GateWindow)
+
+#endif
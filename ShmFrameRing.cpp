@@ -0,0 +1,161 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "ShmFrameRing.h"
+#include "ScopeFrame.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+////////////////////////////////////////////////////////
+ShmFrameWriter::ShmFrameWriter():
+_header(0),
+_bytes(0),
+_maxValues(0),
+_sequence(0),
+_dropped(0)
+{
+}
+
+////////////////////////////////////////////////////////
+ShmFrameWriter::~ShmFrameWriter()
+{
+	close();
+}
+
+////////////////////////////////////////////////////////
+bool
+ShmFrameWriter::create(const std::string& name, int slotCount, int maxValues)
+{
+	close();
+
+	uint32_t slotBytes = shmFrameSlotBytes(maxValues);
+	_header = shmRingCreate(name, slotCount, slotBytes, SHMFRAME_MAGIC);
+	if (!_header) {
+		return false;
+	}
+
+	_name = name;
+	_bytes = shmRingBytes(slotCount, slotBytes);
+	_maxValues = maxValues;
+	return true;
+}
+
+////////////////////////////////////////////////////////
+void
+ShmFrameWriter::unlink()
+{
+	if (!_name.empty()) {
+		shm_unlink(_name.c_str());
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+ShmFrameWriter::close()
+{
+	if (_header) {
+		munmap(_header, _bytes);
+		_header = 0;
+	}
+}
+
+////////////////////////////////////////////////////////
+bool
+ShmFrameWriter::write(const ScopeFrame& frame)
+{
+	if (!_header) {
+		return false;
+	}
+	uint64_t sequence = _sequence++;
+
+	int spectrumCount = frame.spectrum.size();
+	int seriesCount = std::min(frame.I.size(), frame.Q.size());
+	int detectionCount = frame.detections.size();
+	if (spectrumCount > _maxValues || seriesCount > _maxValues
+			|| detectionCount > (_maxValues + 1)/2) {
+		_dropped++;
+		return false;
+	}
+
+	// see how far the reader has got
+	uint64_t w = _header->writeIndex;
+	__sync_synchronize();
+	uint64_t r = _header->readIndex;
+	if (w - r >= _header->slotCount) {
+		_dropped++;
+		return false;
+	}
+
+	ShmFrameHeader* slot = reinterpret_cast<ShmFrameHeader*>(shmRingSlot(_header, w));
+	memset(slot, 0, sizeof(ShmFrameHeader));
+	slot->channel = frame.channel;
+	slot->gate = frame.gate;
+	slot->gates = frame.gates;
+	slot->blockSize = frame.blockSize;
+	slot->zoom = frame.zoom;
+	slot->flags = (frame.alongBeam ? SHMFRAME_ALONG_BEAM : 0)
+		| (frame.window ? SHMFRAME_WINDOW : 0)
+		| (frame.triggered ? SHMFRAME_TRIGGERED : 0);
+	slot->pairChannel = frame.pairChannel;
+	slot->sequence = sequence;
+	slot->spectrumCount = spectrumCount;
+	slot->seriesCount = seriesCount;
+	slot->detectionCount = detectionCount;
+	slot->sampleRateHz = frame.sampleRateHz;
+	slot->zoomCenterHz = frame.zoomCenterHz;
+	slot->zeroMoment = frame.zeroMoment;
+	slot->spectrumZeroMoment = frame.spectrumZeroMoment;
+	slot->meanFreq = frame.moments.meanFreq;
+	slot->width = frame.moments.width;
+	slot->peakFreq = frame.moments.peakFreq;
+	slot->peakPower = frame.moments.peakPower;
+	slot->noisePower = frame.moments.noisePower;
+	slot->snr = frame.moments.snr;
+	slot->processingSecs = frame.processingSecs;
+	slot->timestamp = frame.timestamp;
+
+	float* spectrum = shmFrameSpectrum(slot);
+	for (int i = 0; i < spectrumCount; i++) {
+		spectrum[i] = frame.spectrum[i];
+	}
+	float* iq = shmFrameSeries(slot);
+	for (int i = 0; i < seriesCount; i++) {
+		iq[2*i]   = frame.I[i];
+		iq[2*i+1] = frame.Q[i];
+	}
+	ShmDetection* detections = shmFrameDetections(slot);
+	for (int i = 0; i < detectionCount; i++) {
+		detections[i].gate = frame.detections[i].gate;
+		detections[i].power = frame.detections[i].power;
+		detections[i].snr = frame.detections[i].snr;
+		detections[i].reserved = 0;
+	}
+
+	// the slot contents must be visible before the index
+	__sync_synchronize();
+	_header->writeIndex = w + 1;
+	return true;
+}
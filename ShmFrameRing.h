@@ -0,0 +1,209 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef SHMFRAMERINGINC_
+#define SHMFRAMERINGINC_
+
+#include "ShmRing.h"
+
+class ScopeFrame;
+
+/**
+ The layout of a shared memory frame ring, through which the scope
+ publishes its processed frames (see FramePublisher) to consumers in
+ other processes. It is a ShmRing (see ShmRing.h), with the same
+ ShmRingHeader, index protocol and single reader, but its magic is
+ SHMFRAME_MAGIC and each slot holds a ShmFrameHeader followed by:
+
+ - spectrumCount floats: the power spectrum, in dB, zero frequency
+   in the center;
+ - seriesCount I,Q pairs of floats: the time series;
+ - detectionCount ShmDetection: the targets found along the beam.
+
+ The writer drops a frame, rather than waiting, when the ring is full.
+ Sequence numbers count every frame offered to the writer, so gaps
+ show the frames that a slow reader missed.
+ **/
+
+/// The magic number at the start of a frame ring
+#define SHMFRAME_MAGIC 0x41534346u
+
+/// ShmFrameHeader flags
+enum ShmFrameFlags {
+	/// The time series was taken along the beam
+	SHMFRAME_ALONG_BEAM = 1,
+	/// The hamming window was applied to the spectrum
+	SHMFRAME_WINDOW = 2,
+	/// The block was captured on a trigger
+	SHMFRAME_TRIGGERED = 4
+};
+
+/// The header of each frame slot. 152 bytes.
+struct ShmFrameHeader {
+	/// The channel
+	int32_t channel;
+	/// The gate, if not along the beam
+	int32_t gate;
+	/// The number of gates in the data stream
+	int32_t gates;
+	/// The fft block size
+	int32_t blockSize;
+	/// The spectrum zoom factor
+	int32_t zoom;
+	/// ShmFrameFlags
+	int32_t flags;
+	/// For a two channel frame, the second channel, else -1
+	int32_t pairChannel;
+	/// unused
+	int32_t reserved0;
+	/// The frame sequence number
+	uint64_t sequence;
+	/// The number of spectrum values
+	int32_t spectrumCount;
+	/// The number of I,Q pairs
+	int32_t seriesCount;
+	/// The number of detections
+	int32_t detectionCount;
+	/// unused
+	int32_t reserved1;
+	/// The sample rate of the time series, in Hz
+	double sampleRateHz;
+	/// The center frequency of a zoomed spectrum, in Hz
+	double zoomCenterHz;
+	/// The mean power of the time series, in dB
+	double zeroMoment;
+	/// The zero moment computed from the spectrum, in dB
+	double spectrumZeroMoment;
+	/// The mean Doppler frequency, in Hz
+	double meanFreq;
+	/// The spectrum width, in Hz
+	double width;
+	/// The frequency of the strongest bin, in Hz
+	double peakFreq;
+	/// The power of the strongest bin, in dB
+	double peakPower;
+	/// The noise power of a bin, in dB
+	double noisePower;
+	/// The signal to noise ratio, in dB
+	double snr;
+	/// The time the scope took to make the frame, in seconds
+	double processingSecs;
+	/// The acquisition time of the newest data, in seconds since
+	/// the epoch, or 0 if not known
+	double timestamp;
+};
+
+/// A target along the beam. 16 bytes.
+struct ShmDetection {
+	/// The gate
+	int32_t gate;
+	/// The power, in dB
+	float power;
+	/// The power relative to the noise estimate, in dB
+	float snr;
+	/// unused
+	int32_t reserved;
+};
+
+/// @return The slot size needed for frames of up to a number of
+/// spectrum bins or time series samples, rounded up to a multiple
+/// of 64 bytes. There is room for a detection at every other value.
+/// @param maxValues The largest number of bins or samples.
+inline uint32_t shmFrameSlotBytes(int maxValues) {
+	size_t bytes = sizeof(ShmFrameHeader) + 3*sizeof(float)*maxValues
+		+ sizeof(ShmDetection)*((maxValues + 1)/2);
+	return (uint32_t)((bytes + 63) & ~(size_t)63);
+}
+
+/// @return The spectrum of a frame slot.
+/// @param slot The slot.
+inline float* shmFrameSpectrum(ShmFrameHeader* slot) {
+	return reinterpret_cast<float*>(slot + 1);
+}
+
+/// @return The interleaved I,Q pairs of a frame slot.
+/// @param slot The slot.
+inline float* shmFrameSeries(ShmFrameHeader* slot) {
+	return shmFrameSpectrum(slot) + slot->spectrumCount;
+}
+
+/// @return The detections of a frame slot.
+/// @param slot The slot.
+inline ShmDetection* shmFrameDetections(ShmFrameHeader* slot) {
+	return reinterpret_cast<ShmDetection*>(shmFrameSeries(slot) + 2*slot->seriesCount);
+}
+
+/**
+ ShmFrameWriter is the producer side of a shared memory frame ring.
+ It creates (or replaces) the shared memory object, and copies
+ frames into it. It is not thread safe; FramePublisher serializes
+ the writes.
+ **/
+class ShmFrameWriter {
+public:
+	ShmFrameWriter();
+	/// Destructor. The shared memory object is unmapped, but not
+	/// removed, so that a reader can finish with it.
+	virtual ~ShmFrameWriter();
+	/// Create the ring, replacing any existing one with the same name.
+	/// @param name The shared memory object name, e.g. "/ascope_frames".
+	/// @param slotCount The number of slots.
+	/// @param maxValues The largest number of spectrum bins or
+	/// time series samples in a frame.
+	/// @return False on failure, with errno set.
+	bool create(const std::string& name, int slotCount, int maxValues);
+	/// Remove the shared memory object name.
+	void unlink();
+	/// Unmap the ring. Frames are not written until it is created again.
+	void close();
+	/// @return True if the ring has been created.
+	bool isOpen() const { return _header != 0; }
+	/// Copy a frame into the next slot. Range-time profiles and the
+	/// two channel products are not carried.
+	/// @param frame The frame.
+	/// @return False if the frame was dropped, because the ring is
+	/// full or the frame does not fit in a slot.
+	bool write(const ScopeFrame& frame);
+	/// @return The number of frames dropped.
+	uint64_t dropped() const { return _dropped; }
+
+protected:
+	/// The shared memory object name
+	std::string _name;
+	/// The mapped ring, or null
+	ShmRingHeader* _header;
+	/// The size of the mapping
+	size_t _bytes;
+	/// The largest number of values that fits in a slot
+	int _maxValues;
+	/// The sequence number of the next frame
+	uint64_t _sequence;
+	/// The number of frames dropped
+	uint64_t _dropped;
+
+private:
+	ShmFrameWriter(const ShmFrameWriter&);
+	ShmFrameWriter& operator=(const ShmFrameWriter&);
+};
+
+#endif
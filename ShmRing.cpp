@@ -0,0 +1,154 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "ShmRing.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////
+ShmRingHeader*
+shmRingCreate(const std::string& name, uint32_t slotCount, uint32_t slotBytes, uint32_t magic)
+{
+	size_t bytes = shmRingBytes(slotCount, slotBytes);
+
+	// start from a fresh object, so that a reader still attached
+	// to an old one is not confused by the new layout
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0) {
+		return 0;
+	}
+	if (ftruncate(fd, bytes) < 0) {
+		close(fd);
+		return 0;
+	}
+	void* p = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		return 0;
+	}
+
+	ShmRingHeader* header = static_cast<ShmRingHeader*>(p);
+	memset(header, 0, sizeof(ShmRingHeader));
+	header->slotCount = slotCount;
+	header->slotBytes = slotBytes;
+	header->version = SHMRING_VERSION;
+	// the magic goes last, once the rest is valid
+	__sync_synchronize();
+	header->magic = magic;
+	return header;
+}
+
+////////////////////////////////////////////////////////
+ShmRingWriter::ShmRingWriter():
+_header(0),
+_bytes(0),
+_type(SHMRING_FLOAT),
+_maxGates(0),
+_dropped(0)
+{
+}
+
+////////////////////////////////////////////////////////
+ShmRingWriter::~ShmRingWriter()
+{
+	if (_header) {
+		munmap(_header, _bytes);
+	}
+}
+
+////////////////////////////////////////////////////////
+bool
+ShmRingWriter::create(const std::string& name, int slotCount, int maxGates, ShmSampleType type)
+{
+	if (_header) {
+		munmap(_header, _bytes);
+		_header = 0;
+	}
+
+	uint32_t slotBytes = shmRingSlotBytes(maxGates, type);
+	_header = shmRingCreate(name, slotCount, slotBytes, SHMRING_MAGIC);
+	if (!_header) {
+		return false;
+	}
+
+	_name = name;
+	_bytes = shmRingBytes(slotCount, slotBytes);
+	_type = type;
+	_maxGates = maxGates;
+	return true;
+}
+
+////////////////////////////////////////////////////////
+void
+ShmRingWriter::unlink()
+{
+	if (!_name.empty()) {
+		shm_unlink(_name.c_str());
+	}
+}
+
+////////////////////////////////////////////////////////
+void*
+ShmRingWriter::beginPulse(int chanId, int gates, double sampleRateHz, uint64_t sequence,
+		double timestamp)
+{
+	if (!_header || gates > _maxGates || gates <= 0) {
+		return 0;
+	}
+
+	// see how far the reader has got
+	uint64_t w = _header->writeIndex;
+	__sync_synchronize();
+	uint64_t r = _header->readIndex;
+	if (w - r >= _header->slotCount) {
+		_dropped++;
+		return 0;
+	}
+
+	ShmPulseHeader* slot = shmRingSlot(_header, w);
+	slot->chanId = chanId;
+	slot->gates = gates;
+	slot->sampleRateHz = sampleRateHz;
+	slot->sequence = sequence;
+	slot->timestamp = timestamp;
+	slot->dataType = _type;
+	slot->reserved = 0;
+	return slot + 1;
+}
+
+////////////////////////////////////////////////////////
+void
+ShmRingWriter::commit()
+{
+	if (!_header) {
+		return;
+	}
+	// the slot contents must be visible before the index
+	__sync_synchronize();
+	_header->writeIndex = _header->writeIndex + 1;
+}
@@ -0,0 +1,203 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef SHMRINGINC_
+#define SHMRINGINC_
+
+#include <stdint.h>
+#include <string>
+
+/**
+ The layout of a shared memory pulse ring, through which a producer
+ process hands pulses to a scope in another process. The ring is a
+ POSIX shared memory object (see shm_open(3)) that starts with a
+ ShmRingHeader, followed by slotCount slots of slotBytes each. Each
+ slot holds a ShmPulseHeader followed by the I,Q pairs for the gates,
+ as floats or shorts, interleaved as in AScope::TimeSeries.
+
+ There is one producer and one reader. Slot n (counting from zero
+ since the ring was created) is at index n % slotCount. The producer
+ fills slot writeIndex, then increments writeIndex; it must not fill
+ a slot while writeIndex - readIndex == slotCount. The reader uses
+ slots up to writeIndex in place, and increments readIndex as it
+ finishes with them. Each index is only written by one side, and is
+ read by the other after a memory barrier.
+
+ The structures have fixed sizes and alignment, so that producers
+ written in C or built with another compiler can share them.
+ ShmRingWriter implements the producer side.
+ **/
+
+/// The magic number at the start of a ring
+#define SHMRING_MAGIC 0x41534352u
+/// The layout version
+#define SHMRING_VERSION 2u
+
+/// The sample types in a ring
+enum ShmSampleType {
+	SHMRING_FLOAT = 0,
+	SHMRING_SHORT = 1
+};
+
+/// The header at the start of the shared memory. 64 bytes.
+struct ShmRingHeader {
+	/// SHMRING_MAGIC
+	uint32_t magic;
+	/// SHMRING_VERSION
+	uint32_t version;
+	/// The number of slots
+	uint32_t slotCount;
+	/// The size of each slot, in bytes, including its header
+	uint32_t slotBytes;
+	/// The number of slots filled since the ring was created
+	volatile uint64_t writeIndex;
+	/// The number of slots released by the reader
+	volatile uint64_t readIndex;
+	/// unused
+	uint64_t reserved[4];
+};
+
+/// The header of each slot. 40 bytes.
+struct ShmPulseHeader {
+	/// The channel
+	int32_t chanId;
+	/// The number of gates
+	int32_t gates;
+	/// The sample rate, in Hz
+	double sampleRateHz;
+	/// The pulse sequence number, increasing by one per pulse
+	/// on each channel
+	uint64_t sequence;
+	/// The acquisition time of the pulse, in seconds since the
+	/// epoch, or 0 if unknown
+	double timestamp;
+	/// The ShmSampleType of the I,Q data
+	int32_t dataType;
+	/// unused
+	int32_t reserved;
+};
+
+/// @return The total size of a ring, in bytes.
+/// @param slotCount The number of slots.
+/// @param slotBytes The size of each slot.
+inline size_t shmRingBytes(uint32_t slotCount, uint32_t slotBytes) {
+	return sizeof(ShmRingHeader) + (size_t)slotCount*slotBytes;
+}
+
+/// @return The slot size needed for a number of gates, rounded
+/// up to a multiple of 64 bytes.
+/// @param gates The largest number of gates.
+/// @param type The sample type.
+inline uint32_t shmRingSlotBytes(int gates, ShmSampleType type) {
+	size_t sample = (type == SHMRING_FLOAT) ? sizeof(float) : sizeof(short);
+	size_t bytes = sizeof(ShmPulseHeader) + 2*sample*gates;
+	return (uint32_t)((bytes + 63) & ~(size_t)63);
+}
+
+/// Create a ring's shared memory object, replacing any existing one
+/// with the same name, and initialize its header.
+/// @param name The shared memory object name.
+/// @param slotCount The number of slots.
+/// @param slotBytes The size of each slot.
+/// @param magic The magic number that identifies the slot layout.
+/// @return The mapped ring, of shmRingBytes(slotCount, slotBytes)
+/// bytes, or null on failure, with errno set.
+ShmRingHeader* shmRingCreate(const std::string& name,
+		uint32_t slotCount, uint32_t slotBytes, uint32_t magic);
+
+/// @return A slot.
+/// @param header The ring.
+/// @param n The slot number.
+inline ShmPulseHeader* shmRingSlot(ShmRingHeader* header, uint64_t n) {
+	char* base = reinterpret_cast<char*>(header + 1);
+	return reinterpret_cast<ShmPulseHeader*>(base + (n % header->slotCount)*header->slotBytes);
+}
+
+/**
+ ShmRingWriter is the producer side of a shared memory pulse ring.
+ It creates (or replaces) the shared memory object, and publishes
+ pulses into it:
+
+ @code
+   ShmRingWriter ring;
+   ring.create("/radar_iq", 4096, gates, SHMRING_SHORT);
+   ...
+   short* iq = static_cast<short*>(ring.beginPulse(chan, gates, rate, seq, time));
+   if (iq) {
+       // fill 2*gates values
+       ring.commit();
+   }
+ @endcode
+ **/
+class ShmRingWriter {
+public:
+	ShmRingWriter();
+	/// Destructor. The shared memory object is unmapped, but not
+	/// removed, so that a reader can finish with it.
+	virtual ~ShmRingWriter();
+	/// Create the ring, replacing any existing one with the same name.
+	/// @param name The shared memory object name, e.g. "/radar_iq".
+	/// @param slotCount The number of slots.
+	/// @param maxGates The largest number of gates in a pulse.
+	/// @param type The sample type.
+	/// @return False on failure, with errno set.
+	bool create(const std::string& name, int slotCount, int maxGates, ShmSampleType type);
+	/// Remove the shared memory object name.
+	void unlink();
+	/// Start a pulse in the next slot.
+	/// @param chanId The channel.
+	/// @param gates The number of gates.
+	/// @param sampleRateHz The sample rate.
+	/// @param sequence The pulse sequence number.
+	/// @param timestamp The acquisition time of the pulse, in seconds
+	/// since the epoch, or 0 if unknown.
+	/// @return Where to put the 2*gates I,Q values, or null if the
+	/// ring is full or gates is too large. A full ring means the
+	/// reader is behind; the pulse should be dropped.
+	void* beginPulse(int chanId, int gates, double sampleRateHz, uint64_t sequence,
+			double timestamp = 0.0);
+	/// Publish the pulse started by beginPulse().
+	void commit();
+	/// @return The number of pulses dropped because the ring was full.
+	uint64_t dropped() const { return _dropped; }
+
+protected:
+	/// The shared memory object name
+	std::string _name;
+	/// The mapped ring, or null
+	ShmRingHeader* _header;
+	/// The size of the mapping
+	size_t _bytes;
+	/// The sample type
+	ShmSampleType _type;
+	/// The largest number of gates that fits in a slot
+	int _maxGates;
+	/// The number of pulses dropped
+	uint64_t _dropped;
+
+private:
+	ShmRingWriter(const ShmRingWriter&);
+	ShmRingWriter& operator=(const ShmRingWriter&);
+};
+
+#endif
@@ -0,0 +1,318 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "ShmRingReader.h"
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////
+ShmRingReader::ShmRingReader(QObject* parent):
+QObject(parent),
+_header(0),
+_bytes(0),
+_slotBytes(0),
+_next(0),
+_inFlight(0),
+_pulsesPerItem(32),
+_pulses(0),
+_gaps(0),
+_rejected(0)
+{
+	connect(&_timer, SIGNAL(timeout()), this, SLOT(pollSlot()));
+}
+
+////////////////////////////////////////////////////////
+ShmRingReader::~ShmRingReader()
+{
+	detach();
+
+	// the items still in flight point into these; there is
+	// no one left to take them back, so leave them mapped
+	if (!_retired.empty()) {
+		std::cerr << "ShmRingReader: destroyed with " << inFlight()
+				<< " items in flight; leaving " << _retired.size()
+				<< " ring(s) mapped" << std::endl;
+	}
+}
+
+////////////////////////////////////////////////////////
+bool
+ShmRingReader::attach(const std::string& name)
+{
+	detach();
+
+	int fd = shm_open(name.c_str(), O_RDWR, 0);
+	if (fd < 0) {
+		std::cerr << "ShmRingReader: cannot open " << name << ": "
+				<< strerror(errno) << std::endl;
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ShmRingHeader)) {
+		std::cerr << "ShmRingReader: " << name << " is too small to be a ring" << std::endl;
+		close(fd);
+		return false;
+	}
+	void* p = mmap(0, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		std::cerr << "ShmRingReader: cannot map " << name << ": "
+				<< strerror(errno) << std::endl;
+		return false;
+	}
+
+	ShmRingHeader* header = static_cast<ShmRingHeader*>(p);
+	__sync_synchronize();
+	if (header->magic != SHMRING_MAGIC || header->version != SHMRING_VERSION ||
+			header->slotCount == 0 || header->slotBytes < sizeof(ShmPulseHeader) ||
+			shmRingBytes(header->slotCount, header->slotBytes) > (size_t)st.st_size) {
+		std::cerr << "ShmRingReader: " << name << " is not a valid version "
+				<< SHMRING_VERSION << " ring" << std::endl;
+		munmap(p, st.st_size);
+		return false;
+	}
+
+	_name = name;
+	_header = header;
+	_bytes = st.st_size;
+	_slotBytes = header->slotBytes;
+	_next = _header->readIndex;
+	_sequence.clear();
+	return true;
+}
+
+////////////////////////////////////////////////////////
+void
+ShmRingReader::detach()
+{
+	stop();
+	if (!_header) {
+		return;
+	}
+	if (_inFlight > 0) {
+		// keep the ring until its items come back; swapping keeps
+		// the outstanding records, which are the items' handles, in place
+		_retired.push_back(Retired());
+		Retired& r = _retired.back();
+		r.header = _header;
+		r.bytes = _bytes;
+		r.inFlight = _inFlight;
+		r.outstanding.swap(_outstanding);
+	} else {
+		munmap(_header, _bytes);
+	}
+	_header = 0;
+	_outstanding.clear();
+	_inFlight = 0;
+}
+
+////////////////////////////////////////////////////////
+int
+ShmRingReader::inFlight() const
+{
+	int n = _inFlight;
+	std::list<Retired>::const_iterator r;
+	for (r = _retired.begin(); r != _retired.end(); r++) {
+		n += r->inFlight;
+	}
+	return n;
+}
+
+////////////////////////////////////////////////////////
+void
+ShmRingReader::start(int intervalMs)
+{
+	_timer.start(intervalMs);
+}
+
+////////////////////////////////////////////////////////
+void
+ShmRingReader::stop()
+{
+	_timer.stop();
+}
+
+////////////////////////////////////////////////////////
+void
+ShmRingReader::pollSlot()
+{
+	if (!_header) {
+		return;
+	}
+
+	// the slot contents are read only after the index that covers them
+	uint64_t written = _header->writeIndex;
+	__sync_synchronize();
+
+	// group consecutive pulses that can share an item
+	uint64_t first = _next;
+	int count = 0;
+	ShmPulseHeader head;
+	for (uint64_t n = _next; n < written; n++) {
+		// work from a copy, which the producer cannot change
+		// after it has been checked
+		ShmPulseHeader slot = *shmRingSlot(_header, n);
+
+		// skip a slot that would have us read past its end
+		if (!validSlot(slot)) {
+			if (count > 0) {
+				emitItem(head, first, count);
+				count = 0;
+			}
+			_rejected++;
+			// nothing reads it, so it is released with the slots before it
+			_outstanding.push_back(Outstanding(n + 1));
+			_outstanding.back().returned = true;
+			release();
+			continue;
+		}
+
+		// note the pulses that the producer skipped
+		std::map<int, uint64_t>::iterator s = _sequence.find(slot.chanId);
+		if (s != _sequence.end() && slot.sequence != s->second + 1) {
+			_gaps++;
+		}
+		_sequence[slot.chanId] = slot.sequence;
+
+		if (count > 0 && (count == _pulsesPerItem ||
+				slot.chanId != head.chanId ||
+				slot.gates != head.gates ||
+				slot.dataType != head.dataType)) {
+			emitItem(head, first, count);
+			count = 0;
+		}
+		if (count == 0) {
+			head = slot;
+			first = n;
+		}
+		count++;
+	}
+	if (count > 0) {
+		emitItem(head, first, count);
+	}
+	_next = written;
+}
+
+////////////////////////////////////////////////////////
+bool
+ShmRingReader::validSlot(const ShmPulseHeader& slot) const
+{
+	size_t sample;
+	switch (slot.dataType) {
+	case SHMRING_FLOAT:
+		sample = sizeof(float);
+		break;
+	case SHMRING_SHORT:
+		sample = sizeof(short);
+		break;
+	default:
+		return false;
+	}
+	return slot.gates > 0 &&
+			sizeof(ShmPulseHeader) + 2*sample*(size_t)slot.gates <= _slotBytes;
+}
+
+////////////////////////////////////////////////////////
+void
+ShmRingReader::emitItem(const ShmPulseHeader& head, uint64_t first, int count)
+{
+	AScope::TimeSeries item(head.dataType == SHMRING_SHORT ?
+			AScope::TimeSeries::SHORTDATA : AScope::TimeSeries::FLOATDATA);
+	item.chanId = head.chanId;
+	item.gates = head.gates;
+	item.sampleRateHz = head.sampleRateHz;
+	// the item's time is that of its newest pulse
+	item.timestamp = shmRingSlot(_header, first + count - 1)->timestamp;
+	item.IQbeams.resize(count);
+	for (int i = 0; i < count; i++) {
+		// the I,Q data follow each slot's header
+		item.IQbeams[i] = shmRingSlot(_header, first + i) + 1;
+	}
+
+	// deque elements stay put as it grows and shrinks
+	// at the ends, so the record can be the handle
+	_outstanding.push_back(Outstanding(first + count));
+	item.handle = &_outstanding.back();
+	_inFlight++;
+	_pulses += count;
+
+	emit newTSItem(item);
+}
+
+////////////////////////////////////////////////////////
+void
+ShmRingReader::returnTSItemSlot(AScope::TimeSeries pItem)
+{
+	std::deque<Outstanding>::iterator o;
+	for (o = _outstanding.begin(); o != _outstanding.end(); o++) {
+		if (&*o == pItem.handle) {
+			break;
+		}
+	}
+	if (o == _outstanding.end()) {
+		// it may be from a ring that has been detached
+		std::list<Retired>::iterator r;
+		for (r = _retired.begin(); r != _retired.end(); r++) {
+			for (o = r->outstanding.begin(); o != r->outstanding.end(); o++) {
+				if (&*o == pItem.handle && !o->returned) {
+					o->returned = true;
+					if (--r->inFlight == 0) {
+						munmap(r->header, r->bytes);
+						_retired.erase(r);
+					}
+					return;
+				}
+			}
+		}
+		return;
+	}
+	if (o->returned) {
+		return;
+	}
+	o->returned = true;
+	_inFlight--;
+	release();
+}
+
+////////////////////////////////////////////////////////
+void
+ShmRingReader::release()
+{
+	// release the slots up to the first item still in use
+	uint64_t released = 0;
+	while (!_outstanding.empty() && _outstanding.front().returned) {
+		released = _outstanding.front().end;
+		_outstanding.pop_front();
+	}
+	if (released && _header) {
+		// we are done with the slots before the producer may reuse them
+		__sync_synchronize();
+		_header->readIndex = released;
+	}
+}
@@ -0,0 +1,187 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef SHMRINGREADERINC_
+#define SHMRINGREADERINC_
+
+#include <QObject>
+#include <QTimer>
+#include <deque>
+#include <list>
+#include <map>
+#include <string>
+
+#include "AScope.h"
+#include "ShmRing.h"
+
+/**
+ ShmRingReader feeds pulses from a shared memory pulse ring (see
+ ShmRing.h), written by another process, to a scope or engine, so
+ that a running signal processor can be watched without linking the
+ scope into it.
+
+ The pulses are not copied: each AScope::TimeSeries that is emitted
+ points into the shared slots, and groups consecutive pulses with
+ the same channel, gates and sample type, up to pulsesPerItem().
+ When an item comes back through returnTSItemSlot(), its slots are
+ released to the producer by advancing the ring's read index. Items
+ may come back in any order; the read index only advances over
+ slots that have all been returned.
+
+ @code
+   ShmRingReader reader;
+   reader.attach("/radar_iq");
+   connect(&reader, SIGNAL(newTSItem(AScope::TimeSeries)),
+           scope, SLOT(newTSItemSlot(AScope::TimeSeries)));
+   connect(scope, SIGNAL(returnTSItem(AScope::TimeSeries)),
+           &reader, SLOT(returnTSItemSlot(AScope::TimeSeries)));
+   reader.start();
+ @endcode
+
+ The ring is polled by a timer in the reader's thread. The slot
+ headers come from another process, so a slot whose data type is
+ unknown, or whose gates do not fit in the slot, is skipped and
+ counted in rejected().
+ **/
+class ShmRingReader : public QObject {
+	Q_OBJECT
+public:
+	/// Constructor
+	/// @param parent The parent object.
+	ShmRingReader(QObject* parent = 0);
+	/// Destructor. If items are still in flight, the ring is left
+	/// mapped, since they point into it.
+	virtual ~ShmRingReader();
+	/// Attach to a ring. Reading resumes at the ring's read index.
+	/// @param name The shared memory object name, e.g. "/radar_iq".
+	/// @return False if the ring does not exist or is not valid; the
+	/// reason is reported on stderr.
+	bool attach(const std::string& name);
+	/// Stop polling and detach from the ring. Items in flight point
+	/// into the ring, so it is only unmapped once they have all been
+	/// returned.
+	void detach();
+	/// @return True if attached to a ring.
+	bool attached() const { return _header != 0; }
+	/// Start polling the ring.
+	/// @param intervalMs The polling interval, in ms.
+	void start(int intervalMs = 2);
+	/// Stop polling the ring.
+	void stop();
+	/// Set the largest number of pulses in an item.
+	/// @param n The number of pulses.
+	void setPulsesPerItem(int n) { _pulsesPerItem = n > 0 ? n : 1; }
+	/// @return The largest number of pulses in an item.
+	int pulsesPerItem() const { return _pulsesPerItem; }
+	/// @return The number of items emitted and not yet returned,
+	/// including those from rings that have been detached.
+	int inFlight() const;
+	/// @return The number of pulses read.
+	unsigned long long pulses() const { return _pulses; }
+	/// @return The number of breaks in the pulse sequence numbers,
+	/// i.e. the number of times that the producer skipped pulses.
+	unsigned long long gaps() const { return _gaps; }
+	/// @return The number of slots skipped because their header
+	/// does not describe valid data that fits in the slot.
+	unsigned long long rejected() const { return _rejected; }
+
+signals:
+	/// Emitted for each group of pulses read.
+	/// @param pItem The pulses.
+	void newTSItem(AScope::TimeSeries pItem);
+
+public slots:
+	/// Release the slots of an item. Items that did not
+	/// come from this reader are ignored.
+	/// @param pItem The item.
+	void returnTSItemSlot(AScope::TimeSeries pItem);
+	/// Emit items for the pulses that have been written.
+	void pollSlot();
+
+protected:
+	/// An item that has been emitted
+	class Outstanding {
+	public:
+		Outstanding(uint64_t e): end(e), returned(false) {}
+		/// The slot number after the item's last slot
+		uint64_t end;
+		/// True once the item has been returned
+		bool returned;
+	};
+	/// A ring that was detached while items from it were in flight.
+	/// It stays mapped until they have all been returned.
+	class Retired {
+	public:
+		Retired(): header(0), bytes(0), inFlight(0) {}
+		/// The mapped ring
+		ShmRingHeader* header;
+		/// The size of the mapping
+		size_t bytes;
+		/// The items emitted from it, not yet released
+		std::deque<Outstanding> outstanding;
+		/// The number of items not yet returned
+		int inFlight;
+	};
+	/// @return True if a slot header describes data that fits in a slot.
+	/// @param slot The slot header.
+	bool validSlot(const ShmPulseHeader& slot) const;
+	/// Emit an item.
+	/// @param head A copy of the header of the first slot.
+	/// @param first The first slot number.
+	/// @param count The number of slots.
+	void emitItem(const ShmPulseHeader& head, uint64_t first, int count);
+	/// Release the slots of the returned items at the front of
+	/// _outstanding to the producer.
+	void release();
+	/// The shared memory object name
+	std::string _name;
+	/// The mapped ring, or null
+	ShmRingHeader* _header;
+	/// The size of the mapping
+	size_t _bytes;
+	/// The slot size, as checked when the ring was attached
+	uint32_t _slotBytes;
+	/// The next slot number to read
+	uint64_t _next;
+	/// The items emitted, in slot order, not yet released
+	std::deque<Outstanding> _outstanding;
+	/// The number of items from the ring not yet returned
+	int _inFlight;
+	/// The detached rings with items in flight. Their outstanding
+	/// records were swapped in, so the handles still point at them.
+	std::list<Retired> _retired;
+	/// The largest number of pulses in an item
+	int _pulsesPerItem;
+	/// The last sequence number seen on each channel
+	std::map<int, uint64_t> _sequence;
+	/// The number of pulses read
+	unsigned long long _pulses;
+	/// The number of sequence breaks
+	unsigned long long _gaps;
+	/// The number of slots rejected
+	unsigned long long _rejected;
+	/// The polling timer
+	QTimer _timer;
+};
+
+#endif
@@ -0,0 +1,546 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "SpectrumCalc.h"
+#include "DspKernels.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <cmath>
+#include <algorithm>
+#include <map>
+
+// The fftw planner is not thread safe; plan creation
+// must be serialized.
+static QMutex _plannerMutex;
+
+// A plan, window and bin phase table for one fft length. The plan is created
+// for in-place transforms on fftw_malloc()ed space, and is executed on
+// each SpectrumCalc's own data space with fftw_execute_dft(), which
+// may be called concurrently from several threads.
+struct PlanEntry {
+	fftw_plan plan;
+	std::vector<double> hamming;
+	std::vector<double> binCos;
+	std::vector<double> binSin;
+};
+
+// The plans and window tables, by fft length. Entries are
+// created on demand, or ahead of time by prepare(), and
+// are kept for the life of the process.
+static std::map<int, PlanEntry*> _planCache;
+
+////////////////////////////////////////////////////////
+static PlanEntry*
+planEntry(int size, unsigned int flags)
+{
+	QMutexLocker locker(&_plannerMutex);
+
+	std::map<int, PlanEntry*>::iterator it = _planCache.find(size);
+	if (it != _planCache.end()) {
+		return it->second;
+	}
+
+	PlanEntry* entry = new PlanEntry;
+
+	// Plan on scratch space; planning with anything other than
+	// FFTW_ESTIMATE overwrites the arrays.
+	fftw_complex* scratch = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)* size);
+	entry->plan = fftw_plan_dft_1d(size, scratch, scratch,
+			FFTW_FORWARD,
+			flags);
+	fftw_free(scratch);
+
+	entry->hamming.resize(size);
+	for (int i = 0; i < size; i++) {
+		entry->hamming[i] = 0.54 - 0.46*(cos(2.0*M_PI*i/(size-1)));
+	}
+
+	// bin i is at a frequency of i/size of the sample rate,
+	// which is a phase of 2*pi*i/size on the circle
+	entry->binCos.resize(size);
+	entry->binSin.resize(size);
+	for (int i = 0; i < size; i++) {
+		entry->binCos[i] = cos(2.0*M_PI*i/size);
+		entry->binSin[i] = sin(2.0*M_PI*i/size);
+	}
+
+	_planCache[size] = entry;
+	return entry;
+}
+
+////////////////////////////////////////////////////////
+void
+SpectrumCalc::prepare(std::vector<int> sizes, unsigned int flags)
+{
+	for (unsigned int i = 0; i < sizes.size(); i++) {
+		planEntry(sizes[i], flags);
+	}
+}
+
+////////////////////////////////////////////////////////
+SpectrumCalc::SpectrumCalc(int size):
+_size(0),
+_doHamming(false),
+_hammingCoefs(0),
+_binCos(0),
+_binSin(0),
+_fftwPlan(0),
+_fftwData(0),
+_zoomDecimation(0)
+{
+	setSize(size);
+}
+
+////////////////////////////////////////////////////////
+SpectrumCalc::~SpectrumCalc()
+{
+	// the plan belongs to the cache
+	if (_fftwData) {
+		fftw_free(_fftwData);
+	}
+}
+
+////////////////////////////////////////////////////////
+void
+SpectrumCalc::setSize(int size)
+{
+	if (size == _size) {
+		return;
+	}
+
+	// return existing space, if we have it. The new
+	// space and plan are fetched when first needed.
+	if (_fftwData) {
+		fftw_free(_fftwData);
+		_fftwData = 0;
+	}
+	_fftwPlan = 0;
+	_hammingCoefs = 0;
+	_binCos = 0;
+	_binSin = 0;
+
+	_size = size;
+}
+
+////////////////////////////////////////////////////////
+void
+SpectrumCalc::initFFT()
+{
+	// Fetch the plan and window, creating them if they
+	// were not prepared ahead of time.
+	PlanEntry* entry = planEntry(_size, FFTW_ESTIMATE);
+	_fftwPlan = entry->plan;
+	_hammingCoefs = &entry->hamming[0];
+	_binCos = &entry->binCos[0];
+	_binSin = &entry->binSin[0];
+
+	// allocate space
+	_fftwData = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)* _size);
+}
+
+////////////////////////////////////////////////////////
+double
+SpectrumCalc::powerSpectrum(
+		const std::vector<double>& Idata,
+		const std::vector<double>& Qdata,
+		std::vector<double>& spectrum)
+{
+	int n = std::min(Idata.size(), Qdata.size());
+	return powerSpectrum(n ? &Idata[0] : 0, n ? &Qdata[0] : 0, n, spectrum);
+}
+
+////////////////////////////////////////////////////////
+double
+SpectrumCalc::powerSpectrum(
+		const double* Idata,
+		const double* Qdata,
+		int n,
+		std::vector<double>& spectrum)
+{
+	spectrum.resize(_size);
+
+	transform(Idata, Qdata, n);
+
+	_power.resize(_size);
+	double zeroMoment = DspKernels::get().power(&_fftwData[0][0], _size, &_power[0]);
+	double noise = noiseFloor(&_power[0], _size);
+
+	// reorder and copy the results into spectrum, and gather
+	// the power weighted phasor of the signal above the noise,
+	// and the peak, on the way
+	int nHalf = _size / 2;
+	double nSq = (double) _size * (double) _size;
+	double re = 0.0;
+	double im = 0.0;
+	double signal = 0.0;
+	int peak = 0;
+
+	for (int i = 0; i < _size; i++) {
+		double pow = _power[i];
+		spectrum[(i + nHalf) % _size] = 10.0*log10(pow / nSq);
+		double s = pow > noise ? pow - noise : 0.0;
+		re += s*_binCos[i];
+		im += s*_binSin[i];
+		signal += s;
+		if (pow > _power[peak]) {
+			peak = i;
+		}
+	} // i
+
+	// a floor keeps a silent spectrum finite in dB
+	const double tiny = 1.0e-30;
+	_moments.noisePower = 10.0*log10(noise / nSq + tiny);
+	_moments.snr = 10.0*log10(std::max(zeroMoment - noise*_size, 0.0)/(noise*_size + tiny) + tiny);
+
+	// The length of the mean phasor, R, measures how concentrated
+	// the spectrum is; sqrt(-2 ln R) is the circular standard
+	// deviation. A flat spectrum has R near zero, and is given the
+	// width of a uniform distribution over the band.
+	const double flatWidth = 1.0/sqrt(12.0);
+	double r = signal > 0.0 ? sqrt(re*re + im*im)/signal : 0.0;
+	_moments.meanFreq = atan2(im, re)/(2.0*M_PI);
+	_moments.width = r > 0.0 ? std::min(sqrt(-2.0*log(std::min(r, 1.0)))/(2.0*M_PI), flatWidth) : flatWidth;
+	_moments.peakFreq = (double)(peak < _size - nHalf ? peak : peak - _size)/_size;
+	_moments.peakPower = 10.0*log10(_power[peak] / nSq);
+
+	zeroMoment /= nSq;
+	zeroMoment = 10.0*log10(zeroMoment);
+
+	return zeroMoment;
+}
+
+////////////////////////////////////////////////////////
+double
+SpectrumCalc::noiseFloor(const double* power, int n, int averages)
+{
+	if (n <= 0) {
+		return 0.0;
+	}
+	double lo;
+	double hi;
+	DspKernels::get().minMax(power, n, &lo, &hi);
+	if (hi <= 0.0) {
+		return 0.0;
+	}
+
+	// Histogram the powers in buckets an eighth of an octave wide,
+	// from the smallest power (but no more than 300 dB below the
+	// largest) up. frexp() is much cheaper than a logarithm.
+	const int perOctave = 8;
+	lo = std::max(lo, hi*1.0e-30);
+	int loExp;
+	int hiExp;
+	frexp(lo, &loExp);
+	frexp(hi, &hiExp);
+	int buckets = (hiExp - loExp + 1)*perOctave;
+	_noiseCount.assign(buckets, 0);
+	_noiseSum.assign(buckets, 0.0);
+	_noiseSumSq.assign(buckets, 0.0);
+	for (int i = 0; i < n; i++) {
+		double p = power[i];
+		int b = 0;
+		if (p > lo) {
+			int e;
+			double m = frexp(p, &e);
+			b = std::min((e - loExp)*perOctave + (int)((m - 0.5)*2*perOctave), buckets - 1);
+		}
+		_noiseCount[b]++;
+		_noiseSum[b] += p;
+		_noiseSumSq[b] += p*p;
+	}
+
+	// Hildebrand and Sekhon: the noise is the mean of the largest
+	// set of the weakest bins that is consistent with white noise,
+	// for which the variance is no more than mean^2/averages. The
+	// weakest bucket alone always qualifies.
+	long long count = 0;
+	double sum = 0.0;
+	double sumSq = 0.0;
+	double noise = lo;
+	for (int b = 0; b < buckets; b++) {
+		if (_noiseCount[b] == 0) {
+			continue;
+		}
+		count += _noiseCount[b];
+		sum += _noiseSum[b];
+		sumSq += _noiseSumSq[b];
+		double mean = sum/count;
+		double variance = sumSq/count - mean*mean;
+		if (mean*mean >= averages*variance) {
+			noise = mean;
+		}
+	}
+	return noise;
+}
+
+////////////////////////////////////////////////////////
+void
+SpectrumCalc::transform(const double* Idata, const double* Qdata, int n)
+{
+	if (!_fftwData) {
+		initFFT();
+	}
+
+	if (n > _size) {
+		n = _size;
+	}
+	// transfer the data to the fftw input space
+	if (n > 0) {
+		DspKernels::get().interleave(Idata, Qdata, n, &_fftwData[0][0]);
+	}
+	// zero pad if necessary
+	for (int j = n; j < _size; j++) {
+		_fftwData[j][0] = 0;
+		_fftwData[j][1] = 0;
+	}
+
+	// apply the hamming window to the time series
+	if (_doHamming) {
+		doHamming();
+	}
+
+	// caclulate the fft
+	fftw_execute_dft(_fftwPlan, _fftwData, _fftwData);
+}
+
+////////////////////////////////////////////////////////
+void
+SpectrumCalc::crossSpectra(
+		const double* I1,
+		const double* Q1,
+		const double* I2,
+		const double* Q2,
+		int n,
+		CrossSpectra& products)
+{
+	int segments = n / _size;
+	if (segments < 1) {
+		segments = 1;
+	}
+
+	_segment.resize(_size);
+	_sum11.assign(_size, 0.0);
+	_sum22.assign(_size, 0.0);
+	_sum12.assign(_size, std::complex<double>(0.0, 0.0));
+
+	// Each segment of each channel is transformed once; the
+	// first channel's transform is set aside while the second's
+	// is computed, and then both feed all of the sums.
+	for (int s = 0; s < segments; s++) {
+		int offset = s*_size;
+		int len = std::min(_size, n - offset);
+		transform(I1 + offset, Q1 + offset, len);
+		for (int k = 0; k < _size; k++) {
+			_segment[k] = std::complex<double>(_fftwData[k][0], _fftwData[k][1]);
+		}
+		transform(I2 + offset, Q2 + offset, len);
+		for (int k = 0; k < _size; k++) {
+			std::complex<double> x = _segment[k];
+			std::complex<double> y(_fftwData[k][0], _fftwData[k][1]);
+			_sum11[k] += std::norm(x);
+			_sum22[k] += std::norm(y);
+			_sum12[k] += x*std::conj(y);
+		}
+	}
+
+	products.segments = segments;
+	products.power1.resize(_size);
+	products.power2.resize(_size);
+	products.cross.resize(_size);
+	products.phase.resize(_size);
+	products.coherence.resize(_size);
+	products.differential.resize(_size);
+
+	// a floor keeps empty bins finite in dB
+	const double tiny = 1.0e-30;
+	double scale = 1.0/((double)_size*(double)_size*segments);
+	int nHalf = _size / 2;
+	double total11 = 0.0;
+	double total22 = 0.0;
+	std::complex<double> total12(0.0, 0.0);
+
+	for (int k = 0; k < _size; k++) {
+		int i = (k + nHalf) % _size;
+		double p11 = _sum11[k];
+		double p22 = _sum22[k];
+		std::complex<double> p12 = _sum12[k];
+		double mag12 = std::abs(p12);
+
+		products.power1[i] = 10.0*log10(p11*scale + tiny);
+		products.power2[i] = 10.0*log10(p22*scale + tiny);
+		products.cross[i] = 10.0*log10(mag12*scale + tiny);
+		products.phase[i] = std::arg(p12)*180.0/M_PI;
+		products.coherence[i] = (p11 > 0.0 && p22 > 0.0) ? mag12*mag12/(p11*p22) : 0.0;
+		products.differential[i] = products.power1[i] - products.power2[i];
+
+		total11 += p11;
+		total22 += p22;
+		total12 += p12;
+	}
+
+	// By Parseval, the sums over frequency are the zero lag
+	// (auto and cross) correlations of the windowed series.
+	products.zeroMoment1 = 10.0*log10(total11*scale + tiny);
+	products.zeroMoment2 = 10.0*log10(total22*scale + tiny);
+	products.differentialPower = products.zeroMoment1 - products.zeroMoment2;
+	products.correlation = (total11 > 0.0 && total22 > 0.0) ?
+			std::abs(total12)/sqrt(total11*total22) : 0.0;
+	products.phaseDeg = std::arg(total12)*180.0/M_PI;
+}
+
+////////////////////////////////////////////////////////
+int
+SpectrumCalc::zoomTaps(int decimation)
+{
+	// four zero crossings of the sinc on each side
+	return 8*decimation + 1;
+}
+
+////////////////////////////////////////////////////////
+int
+SpectrumCalc::zoomInputLength(int decimation) const
+{
+	if (decimation <= 1) {
+		return _size;
+	}
+	return _size*decimation + zoomTaps(decimation) - 1;
+}
+
+////////////////////////////////////////////////////////
+void
+SpectrumCalc::zoomSetup(int decimation)
+{
+	if (decimation == _zoomDecimation) {
+		return;
+	}
+
+	// Hamming windowed sinc, cutoff at half of the
+	// decimated sample rate, with unity gain at DC.
+	int taps = zoomTaps(decimation);
+	double center = (taps - 1) / 2.0;
+	double sum = 0.0;
+	_zoomFilter.resize(taps);
+	for (int k = 0; k < taps; k++) {
+		double x = (k - center) / decimation;
+		double sinc = (x == 0.0) ? 1.0 : sin(M_PI*x)/(M_PI*x);
+		double w = 0.54 - 0.46*cos(2.0*M_PI*k/(taps-1));
+		_zoomFilter[k] = sinc * w;
+		sum += _zoomFilter[k];
+	}
+	for (int k = 0; k < taps; k++) {
+		_zoomFilter[k] /= sum;
+	}
+
+	_zoomDecimation = decimation;
+}
+
+////////////////////////////////////////////////////////
+double
+SpectrumCalc::zoomSpectrum(
+		const double* Idata,
+		const double* Qdata,
+		int n,
+		int decimation,
+		double centerFreq,
+		std::vector<double>& spectrum)
+{
+	if (decimation <= 1) {
+		return powerSpectrum(Idata, Qdata, n, spectrum);
+	}
+
+	zoomSetup(decimation);
+
+	int nIn = zoomInputLength(decimation);
+	if (n > nIn) {
+		n = nIn;
+	}
+
+	// Mix the sub-band center down to zero frequency. The phasor is
+	// advanced by complex multiplication, and renormalized now and
+	// then to keep rounding errors from building up.
+	_mixI.resize(nIn);
+	_mixQ.resize(nIn);
+	double wr = cos(-2.0*M_PI*centerFreq);
+	double wi = sin(-2.0*M_PI*centerFreq);
+	double pr = 1.0;
+	double pi = 0.0;
+	for (int j = 0; j < n; j++) {
+		_mixI[j] = Idata[j]*pr - Qdata[j]*pi;
+		_mixQ[j] = Idata[j]*pi + Qdata[j]*pr;
+		double t = pr*wr - pi*wi;
+		pi = pr*wi + pi*wr;
+		pr = t;
+		if ((j & 1023) == 1023) {
+			double mag = sqrt(pr*pr + pi*pi);
+			pr /= mag;
+			pi /= mag;
+		}
+	}
+	// zero pad if necessary
+	for (int j = n; j < nIn; j++) {
+		_mixI[j] = 0.0;
+		_mixQ[j] = 0.0;
+	}
+
+	// Low pass filter, computing only the outputs
+	// that survive decimation.
+	int taps = _zoomFilter.size();
+	const double* h = &_zoomFilter[0];
+	_zoomI.resize(_size);
+	_zoomQ.resize(_size);
+	for (int m = 0; m < _size; m++) {
+		const double* xi = &_mixI[m*decimation];
+		const double* xq = &_mixQ[m*decimation];
+		double accI = 0.0;
+		double accQ = 0.0;
+		for (int k = 0; k < taps; k++) {
+			accI += h[k]*xi[k];
+			accQ += h[k]*xq[k];
+		}
+		_zoomI[m] = accI;
+		_zoomQ[m] = accQ;
+	}
+
+	return powerSpectrum(&_zoomI[0], &_zoomQ[0], _size, spectrum);
+}
+
+////////////////////////////////////////////////////////
+double
+SpectrumCalc::zeroMomentFromTimeSeries(
+		const double* I,
+		const double* Q,
+		int n)
+{
+	double p = DspKernels::get().sumSquares(I, Q, n);
+
+	p /= n;
+	p = 10.0*log10(p);
+	return p;
+}
+
+////////////////////////////////////////////////////////
+void
+SpectrumCalc::doHamming()
+{
+	DspKernels::get().window(&_fftwData[0][0], _hammingCoefs, _size);
+}
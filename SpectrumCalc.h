@@ -0,0 +1,328 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef SPECTRUMCALCINC_
+#define SPECTRUMCALCINC_
+
+#include <vector>
+#include <complex>
+#include <fftw3.h>
+
+/**
+ The products of two channels' spectra, averaged over segments,
+ as computed by SpectrumCalc::crossSpectra(). The spectra are in
+ the same order as SpectrumCalc::powerSpectrum(), with zero
+ frequency in the center.
+ **/
+class CrossSpectra {
+public:
+	CrossSpectra():
+		segments(0),
+		zeroMoment1(0.0),
+		zeroMoment2(0.0),
+		differentialPower(0.0),
+		correlation(0.0),
+		phaseDeg(0.0)
+		{}
+	/// The number of segments averaged
+	int segments;
+	/// The power spectrum of the first channel, in dB
+	std::vector<double> power1;
+	/// The power spectrum of the second channel, in dB
+	std::vector<double> power2;
+	/// The magnitude of the cross spectrum, in dB
+	std::vector<double> cross;
+	/// The phase of the cross spectrum, first channel relative
+	/// to the second, in degrees
+	std::vector<double> phase;
+	/// The magnitude squared coherence, from 0 to 1
+	std::vector<double> coherence;
+	/// The power of the first channel relative to the second, in dB
+	std::vector<double> differential;
+	/// The mean power of the first channel, in dB
+	double zeroMoment1;
+	/// The mean power of the second channel, in dB
+	double zeroMoment2;
+	/// The mean power of the first channel relative to the
+	/// second, in dB (ZDR, for horizontal and vertical channels)
+	double differentialPower;
+	/// The magnitude of the zero lag correlation coefficient
+	/// between the channels, from 0 to 1
+	double correlation;
+	/// The phase of the zero lag cross correlation, in degrees
+	double phaseDeg;
+};
+
+/**
+ The shape of a power spectrum, as computed along with it by
+ SpectrumCalc::powerSpectrum(). From SpectrumCalc the frequencies
+ are fractions of the sample rate, between -0.5 and 0.5; scaled()
+ converts them. The mean is taken on the circle, treating each bin
+ as a phase, so a signal that aliases across the band edge has a
+ mean near the edge rather than near zero, and the width is the
+ corresponding circular standard deviation. The mean and width are
+ taken over the power above the noise floor.
+ **/
+class SpectralMoments {
+public:
+	SpectralMoments():
+		meanFreq(0.0),
+		width(0.0),
+		peakFreq(0.0),
+		peakPower(0.0),
+		noisePower(0.0),
+		snr(0.0)
+		{}
+	/// The power weighted mean frequency (the mean Doppler)
+	double meanFreq;
+	/// The spectrum width, the spread of frequency about the mean
+	double width;
+	/// The frequency of the strongest bin
+	double peakFreq;
+	/// The power of the strongest bin, in dB
+	double peakPower;
+	/// The noise power of a bin, in dB, from SpectrumCalc::noiseFloor()
+	double noisePower;
+	/// The ratio of the power above the noise to the noise, in dB
+	double snr;
+	/// @return The moments with the frequencies in other units.
+	/// @param rate The sample rate, in the new units.
+	/// @param center The frequency that zero moves to, in the new units.
+	SpectralMoments scaled(double rate, double center) const {
+		SpectralMoments m(*this);
+		m.meanFreq = center + meanFreq*rate;
+		m.width = width*rate;
+		m.peakFreq = center + peakFreq*rate;
+		return m;
+	}
+};
+
+/**
+ SpectrumCalc holds the numerics used to turn a block of I and Q
+ samples into a power spectrum and zeroth moment. It has no
+ dependency on the display, so that the same code can be used
+ by AScope and by offline processing tools.
+
+ Each SpectrumCalc owns its own fftw data space, and so an
+ instance must only be used by one thread at a time. Separate
+ instances may be used concurrently. The fftw plans and window
+ tables are shared by all instances, and are created the first time
+ an fft length is used. prepare() can be called, typically on a
+ background thread, to build them ahead of time.
+ **/
+class SpectrumCalc {
+public:
+	/// Constructor
+	/// @param size The fft length.
+	SpectrumCalc(int size = 64);
+	/// Destructor
+	virtual ~SpectrumCalc();
+	/// Build the fftw plans and hamming tables for a set of fft
+	/// lengths, so that later calls to setSize() for these lengths
+	/// do not pay for planning. This may be called from any thread.
+	/// @param sizes The fft lengths.
+	/// @param flags The fftw planner flags, e.g. FFTW_MEASURE. Lengths
+	/// that already have a plan are not replanned.
+	static void prepare(std::vector<int> sizes, unsigned int flags);
+	/// Change the fft length. The fftw space, plan and hamming
+	/// coefficients for the new length are set up on the next
+	/// call to powerSpectrum().
+	/// @param size The fft length.
+	void setSize(int size);
+	/// @return The fft length.
+	int size() const { return _size; }
+	/// Enable/disable the hamming window.
+	/// @param flag True to apply the hamming window.
+	void setWindow(bool flag) { _doHamming = flag; }
+	/// @return True if the hamming window is being applied.
+	bool window() const { return _doHamming; }
+	/// Compute the power spectrum. The spectrum is returned in dB,
+	/// reordered so that zero frequency is in the center. If fewer
+	/// than size() samples are provided, the time series is zero
+	/// padded; if more are provided, only the leading size() samples
+	/// are used.
+	/// @param Idata The I time series.
+	/// @param Qdata The Q time series.
+	/// @param n The number of samples in Idata and Qdata.
+	/// @param spectrum The power spectrum is returned here. It will
+	/// be resized to size().
+	/// @return The zero moment, in dB. The higher moments are
+	/// available from moments().
+	double powerSpectrum(
+			const double* Idata,
+			const double* Qdata,
+			int n,
+			std::vector<double>& spectrum);
+	/// Compute the power spectrum.
+	/// @param Idata The I time series.
+	/// @param Qdata The Q time series.
+	/// @param spectrum The power spectrum is returned here.
+	/// @return The zero moment, in dB.
+	double powerSpectrum(
+			const std::vector<double>& Idata,
+			const std::vector<double>& Qdata,
+			std::vector<double>& spectrum);
+	/// Compute a zoomed power spectrum, covering a sub-band of width
+	/// 1/decimation of the sample rate, centered on centerFreq. The time
+	/// series is mixed down by centerFreq, low pass filtered and
+	/// decimated, and then transformed with an fft of size(). The
+	/// frequency resolution is thus decimation times finer than that
+	/// of powerSpectrum(), for an fft of the same length.
+	/// zoomInputLength() samples are needed; if fewer are provided
+	/// the time series is zero padded.
+	/// @param Idata The I time series.
+	/// @param Qdata The Q time series.
+	/// @param n The number of samples in Idata and Qdata.
+	/// @param decimation The zoom factor. If 1, this is the same as
+	/// powerSpectrum().
+	/// @param centerFreq The center of the sub-band, as a fraction of the
+	/// sample rate, between -0.5 and 0.5.
+	/// @param spectrum The power spectrum is returned here, in dB,
+	/// with centerFreq in the middle. It will be resized to size().
+	/// @return The zero moment of the sub-band, in dB.
+	double zoomSpectrum(
+			const double* Idata,
+			const double* Qdata,
+			int n,
+			int decimation,
+			double centerFreq,
+			std::vector<double>& spectrum);
+	/// Compute the cross-channel products of two time series, with
+	/// Welch's method: the series are split into segments of size()
+	/// samples, each segment of each channel is transformed once,
+	/// and the auto and cross spectra are averaged over the segments.
+	/// Everything else is derived from those averages. The coherence
+	/// is only meaningful with several segments; with one it is 1.
+	/// @param I1 The I time series of the first channel.
+	/// @param Q1 The Q time series of the first channel.
+	/// @param I2 The I time series of the second channel.
+	/// @param Q2 The Q time series of the second channel.
+	/// @param n The number of samples in each series. If it is not
+	/// a multiple of size(), the trailing samples are not used; if
+	/// it is less, the series are zero padded.
+	/// @param products The results are returned here.
+	void crossSpectra(
+			const double* I1,
+			const double* Q1,
+			const double* I2,
+			const double* Q2,
+			int n,
+			CrossSpectra& products);
+	/// @return The moments of the last spectrum computed by
+	/// powerSpectrum() or zoomSpectrum(). For a zoomed spectrum, the
+	/// frequencies are relative to its center, as fractions of the
+	/// decimated sample rate.
+	const SpectralMoments& moments() const { return _moments; }
+	/// Estimate the noise level of a spectrum, with the method of
+	/// Hildebrand and Sekhon: the weakest bins are added in until they
+	/// stop looking like white noise. Rather than sorting, the bins are
+	/// histogrammed in power, so the cost is two passes over them.
+	/// @param power The power of each bin, in linear units.
+	/// @param n The number of bins.
+	/// @param averages The number of spectra averaged into power.
+	/// @return The noise power of a bin, in the units of power.
+	double noiseFloor(const double* power, int n, int averages = 1);
+	/// @return The number of input samples used by zoomSpectrum().
+	/// @param decimation The zoom factor.
+	int zoomInputLength(int decimation) const;
+	/// @return The length of the decimation filter for a zoom factor.
+	/// @param decimation The zoom factor.
+	static int zoomTaps(int decimation);
+	/// Calculate the zeroth moment, using the time
+	/// series for input.
+	/// @param I The I time series.
+	/// @param Q The Q time series.
+	/// @param n The number of samples.
+	/// @return The mean power, in dB.
+	static double zeroMomentFromTimeSeries(
+			const double* I,
+			const double* Q,
+			int n);
+
+protected:
+	/// Allocate the fftw space, and fetch the plan and hamming
+	/// coefficients for the current length.
+	void initFFT();
+	/// Apply the hamming filter to the fftw data.
+	void doHamming();
+	/// Load a time series into the fftw data, zero padding or
+	/// truncating it to size(), apply the window if enabled, and
+	/// transform it in place.
+	/// @param Idata The I time series.
+	/// @param Qdata The Q time series.
+	/// @param n The number of samples.
+	void transform(const double* Idata, const double* Qdata, int n);
+	/// Create the zoom decimation filter.
+	/// @param decimation The zoom factor.
+	void zoomSetup(int decimation);
+	/// The fft length
+	int _size;
+	/// Set true if the Hamming window should be applied
+	bool _doHamming;
+	/// The hamming window coefficients, from the shared table.
+	const double* _hammingCoefs;
+	/// The cosine of the phase of each bin, from the shared table.
+	const double* _binCos;
+	/// The sine of the phase of each bin, from the shared table.
+	const double* _binSin;
+	///	The fftw plan, from the shared table.
+	fftw_plan _fftwPlan;
+	///	The fftw data array. The fft is performed in place.
+	fftw_complex* _fftwData;
+	/// The zoom factor that _zoomFilter was designed for.
+	int _zoomDecimation;
+	/// The zoom low pass filter coefficients.
+	std::vector<double> _zoomFilter;
+	/// The mixed down time series, I.
+	std::vector<double> _mixI;
+	/// The mixed down time series, Q.
+	std::vector<double> _mixQ;
+	/// The decimated time series, I.
+	std::vector<double> _zoomI;
+	/// The decimated time series, Q.
+	std::vector<double> _zoomQ;
+	/// The transform of the first channel's segment, for crossSpectra().
+	std::vector<std::complex<double> > _segment;
+	/// The auto spectrum sums of the first channel.
+	std::vector<double> _sum11;
+	/// The auto spectrum sums of the second channel.
+	std::vector<double> _sum22;
+	/// The cross spectrum sums.
+	std::vector<std::complex<double> > _sum12;
+	/// The power in each bin, in transform order.
+	std::vector<double> _power;
+	/// The moments of the last power spectrum
+	SpectralMoments _moments;
+	/// The number of bins in each noiseFloor() histogram bucket
+	std::vector<int> _noiseCount;
+	/// The power in each noiseFloor() histogram bucket
+	std::vector<double> _noiseSum;
+	/// The squared power in each noiseFloor() histogram bucket
+	std::vector<double> _noiseSumSq;
+
+private:
+	// Not copyable; we own the fftw data space.
+	SpectrumCalc(const SpectrumCalc&);
+	SpectrumCalc& operator=(const SpectrumCalc&);
+};
+#endif
@@ -0,0 +1,102 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#include "Trigger.h"
+
+#include <cmath>
+
+////////////////////////////////////////////////////////
+TriggerSpec::TriggerSpec():
+mode(OFF),
+level(0.0),
+preSamples(0),
+powerWindow(8)
+{
+}
+
+////////////////////////////////////////////////////////
+bool
+TriggerSpec::operator<(const TriggerSpec& o) const
+{
+	if (mode != o.mode)
+		return mode < o.mode;
+	if (mode == OFF)
+		return false;
+	if (level != o.level)
+		return level < o.level;
+	if (preSamples != o.preSamples)
+		return preSamples < o.preSamples;
+	if (mode == POWER)
+		return powerWindow < o.powerWindow;
+	return false;
+}
+
+////////////////////////////////////////////////////////
+bool
+TriggerSpec::operator==(const TriggerSpec& o) const
+{
+	return !(*this < o) && !(o < *this);
+}
+
+////////////////////////////////////////////////////////
+TriggerDetector::TriggerDetector(const TriggerSpec& spec):
+_spec(spec),
+_threshold(0.0)
+{
+	switch (_spec.mode) {
+	case TriggerSpec::LEVEL:
+		// compare squared amplitudes, to save a sqrt per sample
+		_threshold = _spec.level*_spec.level;
+		break;
+	case TriggerSpec::POWER:
+		// compare the window sum, to save a divide per sample
+		if (_spec.powerWindow < 1) {
+			_spec.powerWindow = 1;
+		}
+		_powers.resize(_spec.powerWindow);
+		_threshold = _spec.powerWindow*pow(10.0, _spec.level/10.0);
+		break;
+	default:
+		break;
+	}
+	reset();
+}
+
+////////////////////////////////////////////////////////
+TriggerDetector::~TriggerDetector()
+{
+}
+
+////////////////////////////////////////////////////////
+void
+TriggerDetector::reset()
+{
+	// Edge triggers need to see the signal on the far side of
+	// the level first; the others fire if it is already above.
+	_armed = (_spec.mode != TriggerSpec::RISING_EDGE &&
+			_spec.mode != TriggerSpec::FALLING_EDGE);
+	_powers.assign(_powers.size(), 0.0);
+	_powerSum = 0.0;
+	_next = 0;
+	_filled = 0;
+}
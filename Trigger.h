@@ -0,0 +1,145 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+#ifndef TRIGGERINC_
+#define TRIGGERINC_
+
+#include <vector>
+
+/**
+ TriggerSpec describes an oscilloscope style trigger on a
+ fixed gate time series. It is a value type, so that it can
+ be part of a selection and compared.
+ **/
+class TriggerSpec {
+public:
+	/// The trigger condition
+	enum Mode {
+		/// No trigger: blocks are taken whenever they are asked for
+		OFF,
+		/// The amplitude, sqrt(I*I + Q*Q), reaches the level
+		LEVEL,
+		/// I crosses the level going up
+		RISING_EDGE,
+		/// I crosses the level going down
+		FALLING_EDGE,
+		/// The mean power over powerWindow samples reaches
+		/// the level, which is in dB
+		POWER
+	};
+	TriggerSpec();
+	bool operator<(const TriggerSpec& other) const;
+	bool operator==(const TriggerSpec& other) const;
+	/// @return True if the trigger is enabled.
+	bool enabled() const { return mode != OFF; }
+	/// The trigger condition
+	Mode mode;
+	/// The trigger level. In data units, except for POWER,
+	/// where it is in dB.
+	double level;
+	/// The number of samples to keep from before the trigger.
+	/// The rest of the block comes from after it.
+	int preSamples;
+	/// The number of samples averaged for the POWER trigger.
+	int powerWindow;
+};
+
+/**
+ TriggerDetector evaluates a TriggerSpec one sample at a time. The
+ cost per sample is a few arithmetic operations, so it can run on
+ every pulse in the gather path. After firing, a level or power
+ trigger does not fire again until the signal has dropped below the
+ level; edge triggers need a new crossing.
+ **/
+class TriggerDetector {
+public:
+	/// Constructor
+	/// @param spec The trigger.
+	TriggerDetector(const TriggerSpec& spec = TriggerSpec());
+	/// Destructor
+	virtual ~TriggerDetector();
+	/// Forget the signal history and rearm.
+	void reset();
+	/// Examine the next sample.
+	/// @param i The I value.
+	/// @param q The Q value.
+	/// @return True if the trigger fires on this sample.
+	inline bool sample(double i, double q) {
+		bool above;
+		switch (_spec.mode) {
+		case TriggerSpec::LEVEL:
+			above = (i*i + q*q >= _threshold);
+			break;
+		case TriggerSpec::RISING_EDGE:
+			above = (i >= _spec.level);
+			break;
+		case TriggerSpec::FALLING_EDGE:
+			above = (i <= _spec.level);
+			break;
+		case TriggerSpec::POWER: {
+			double p = i*i + q*q;
+			_powerSum += p - _powers[_next];
+			_powers[_next] = p;
+			if (++_next == _powers.size()) {
+				// resum once per window, so rounding
+				// errors do not accumulate
+				_next = 0;
+				_powerSum = 0.0;
+				for (unsigned int k = 0; k < _powers.size(); k++) {
+					_powerSum += _powers[k];
+				}
+			}
+			if (_filled < (int)_powers.size()) {
+				_filled++;
+				return false;
+			}
+			above = (_powerSum >= _threshold);
+			break;
+		}
+		default:
+			return false;
+		}
+		// fire on the transition into the condition
+		bool fire = above && _armed;
+		_armed = !above;
+		return fire;
+	}
+
+protected:
+	/// The trigger
+	TriggerSpec _spec;
+	/// The comparison threshold, precomputed from the level
+	double _threshold;
+	/// True when the condition was false on the last sample
+	bool _armed;
+	/// Recent sample powers, for the POWER trigger
+	std::vector<double> _powers;
+	/// The sum of _powers
+	double _powerSum;
+	/// The next index to replace in _powers
+	unsigned int _next;
+	/// The number of valid entries in _powers
+	int _filled;
+};
+
+#endif
@@ -0,0 +1,432 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ascope_batch: offline computation of AScope power spectra and moments
+// from recorded time series.
+//
+// The input is a raw file of interleaved I,Q samples, either 16 bit
+// integers or 32 bit floats, in native byte order. Pulses for each channel
+// follow each other, i.e. the file layout is
+//
+//     pulse 0 chan 0: I0 Q0 I1 Q1 ... (gates pairs)
+//     pulse 0 chan 1: ...
+//     ...
+//     pulse 1 chan 0: ...
+//
+// which is the layout of AScope::TimeSeries::IQbeams[] written out one
+// beam after another. For each channel and each selected gate, the time
+// series is cut into consecutive blocks of blocksize pulses, and each block
+// is run through the same SpectrumCalc numerics used by AScope.
+//
+// The work is split into tasks by channel, gate range and time block, and
+// the tasks are run on all available cores. Results are written in
+// (time block, channel, gate) order, as either CSV or binary records.
+//
+// A CSV record is:
+//     block,channel,gate,power_dB,spectrum_dB[0],...,spectrum_dB[blocksize-1]
+// A binary record, in native byte order, is a header of
+//     int64 block, int32 channel, int32 gate
+// followed by power_dB and the spectrum as 32 bit floats, i.e.
+// 16+(1+blocksize)*4 bytes per record. The block index is an integer
+// so that it stays exact in long recordings.
+
+#include "SpectrumCalc.h"
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <QThreadStorage>
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include <stdint.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/// The header of a binary output record, which is followed by
+/// the power and the spectrum as floats
+struct BinRecordHeader {
+	/// The time block
+	int64_t block;
+	/// The channel
+	int32_t channel;
+	/// The gate
+	int32_t gate;
+};
+
+/// Command line options
+struct Options {
+	Options():
+		gates(0),
+		channels(1),
+		isFloat(false),
+		blockSize(256),
+		gateStart(0),
+		gateStop(-1),
+		gatesPerTask(64),
+		window(false),
+		csv(true),
+		threads(0),
+		sampleRateHz(0.0)
+		{}
+	std::string input;
+	std::string output;
+	int gates;
+	int channels;
+	bool isFloat;
+	int blockSize;
+	int gateStart;
+	int gateStop;
+	int gatesPerTask;
+	bool window;
+	bool csv;
+	int threads;
+	double sampleRateHz;
+};
+
+/// The mapped input file
+struct Input {
+	Input(): data(0), length(0), sampleBytes(0), pulseBytes(0), pulses(0) {}
+	const char* data;
+	size_t length;
+	int sampleBytes;
+	size_t pulseBytes;
+	long long pulses;   ///< pulses per channel
+};
+
+// Each worker thread keeps its own SpectrumCalc, so that fftw
+// plans are created only once per thread.
+static QThreadStorage<SpectrumCalc*> _calcs;
+
+//////////////////////////////////////////////////////////////////////
+static void usage(const char* prog) {
+	std::cerr <<
+	"usage: " << prog << " [options] --gates N input output\n"
+	"  -g, --gates N         number of gates per pulse (required)\n"
+	"  -c, --channels N      number of interleaved channels (1)\n"
+	"  -t, --type T          sample type: short or float (short)\n"
+	"  -b, --block N         block (fft) size, a power of two (256)\n"
+	"  -s, --start-gate N    first gate to process (0)\n"
+	"  -e, --stop-gate N     last gate to process (gates-1)\n"
+	"  -w, --window          apply the hamming window\n"
+	"  -f, --format F        output format: csv or bin (csv)\n"
+	"  -j, --threads N       number of worker threads (all cores)\n"
+	"  -r, --rate HZ         sample rate; if given, a frequency header\n"
+	"                        line is written at the top of csv output\n"
+	"  -G, --task-gates N    gates per task (64)\n";
+}
+
+//////////////////////////////////////////////////////////////////////
+static bool parseArgs(int argc, char** argv, Options& opt) {
+	static struct option longOpts[] = {
+		{"gates",      required_argument, 0, 'g'},
+		{"channels",   required_argument, 0, 'c'},
+		{"type",       required_argument, 0, 't'},
+		{"block",      required_argument, 0, 'b'},
+		{"start-gate", required_argument, 0, 's'},
+		{"stop-gate",  required_argument, 0, 'e'},
+		{"window",     no_argument,       0, 'w'},
+		{"format",     required_argument, 0, 'f'},
+		{"threads",    required_argument, 0, 'j'},
+		{"rate",       required_argument, 0, 'r'},
+		{"task-gates", required_argument, 0, 'G'},
+		{"help",       no_argument,       0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long(argc, argv, "g:c:t:b:s:e:wf:j:r:G:h", longOpts, 0)) != -1) {
+		switch (c) {
+		case 'g': opt.gates = atoi(optarg); break;
+		case 'c': opt.channels = atoi(optarg); break;
+		case 't':
+			if (!strcmp(optarg, "float")) {
+				opt.isFloat = true;
+			} else if (!strcmp(optarg, "short")) {
+				opt.isFloat = false;
+			} else {
+				std::cerr << "unknown sample type " << optarg << std::endl;
+				return false;
+			}
+			break;
+		case 'b': opt.blockSize = atoi(optarg); break;
+		case 's': opt.gateStart = atoi(optarg); break;
+		case 'e': opt.gateStop = atoi(optarg); break;
+		case 'w': opt.window = true; break;
+		case 'f':
+			if (!strcmp(optarg, "csv")) {
+				opt.csv = true;
+			} else if (!strcmp(optarg, "bin")) {
+				opt.csv = false;
+			} else {
+				std::cerr << "unknown output format " << optarg << std::endl;
+				return false;
+			}
+			break;
+		case 'j': opt.threads = atoi(optarg); break;
+		case 'r': opt.sampleRateHz = atof(optarg); break;
+		case 'G': opt.gatesPerTask = atoi(optarg); break;
+		default:
+			return false;
+		}
+	}
+
+	if (argc - optind != 2) {
+		return false;
+	}
+	opt.input = argv[optind];
+	opt.output = argv[optind+1];
+
+	if (opt.gateStop < 0) {
+		opt.gateStop = opt.gates - 1;
+	}
+
+	if (opt.gates <= 0 || opt.channels <= 0 || opt.gatesPerTask <= 0) {
+		std::cerr << "gates, channels and task gates must be positive" << std::endl;
+		return false;
+	}
+	if (opt.blockSize < 2 || (opt.blockSize & (opt.blockSize-1))) {
+		std::cerr << "block size must be a power of two" << std::endl;
+		return false;
+	}
+	if (opt.gateStart < 0 || opt.gateStop >= opt.gates || opt.gateStart > opt.gateStop) {
+		std::cerr << "invalid gate range" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ A Task computes the spectra and moments for one channel, a range of
+ gates, and one time block. The formatted results are left in _result,
+ to be written out in order by the main thread.
+ **/
+class Task : public QRunnable {
+public:
+	Task(const Options& opt, const Input& in, int chan, int gate0, int gate1, long long block):
+		_opt(opt), _in(in), _chan(chan), _gate0(gate0), _gate1(gate1), _block(block)
+	{
+		setAutoDelete(false);
+	}
+
+	virtual void run() {
+		if (!_calcs.hasLocalData()) {
+			_calcs.setLocalData(new SpectrumCalc(_opt.blockSize));
+		}
+		SpectrumCalc* calc = _calcs.localData();
+		calc->setWindow(_opt.window);
+
+		int n = _opt.blockSize;
+		int nGates = _gate1 - _gate0 + 1;
+
+		// Gather the block, pulse by pulse, into gate-major storage.
+		// This walks the input file sequentially.
+		std::vector<double> I(nGates*n);
+		std::vector<double> Q(nGates*n);
+		for (int t = 0; t < n; t++) {
+			long long pulse = _block*n + t;
+			const char* p = _in.data +
+				(pulse*_opt.channels + _chan) * _in.pulseBytes;
+			if (_opt.isFloat) {
+				const float* iq = reinterpret_cast<const float*>(p);
+				for (int g = 0; g < nGates; g++) {
+					I[g*n + t] = iq[2*(_gate0 + g)];
+					Q[g*n + t] = iq[2*(_gate0 + g) + 1];
+				}
+			} else {
+				const short* iq = reinterpret_cast<const short*>(p);
+				for (int g = 0; g < nGates; g++) {
+					I[g*n + t] = iq[2*(_gate0 + g)];
+					Q[g*n + t] = iq[2*(_gate0 + g) + 1];
+				}
+			}
+		}
+
+		std::vector<double> spectrum;
+		std::ostringstream csv;
+		std::string bin;
+		if (!_opt.csv) {
+			bin.reserve(nGates*(sizeof(BinRecordHeader) + (1 + n)*sizeof(float)));
+		}
+		std::vector<float> values(1 + n);
+
+		for (int g = 0; g < nGates; g++) {
+			const double* Ig = &I[g*n];
+			const double* Qg = &Q[g*n];
+			double power = SpectrumCalc::zeroMomentFromTimeSeries(Ig, Qg, n);
+			calc->powerSpectrum(Ig, Qg, n, spectrum);
+
+			if (_opt.csv) {
+				csv << _block << "," << _chan << "," << _gate0 + g << "," << power;
+				for (int i = 0; i < n; i++) {
+					csv << "," << spectrum[i];
+				}
+				csv << "\n";
+			} else {
+				BinRecordHeader header;
+				header.block = _block;
+				header.channel = _chan;
+				header.gate = _gate0 + g;
+				bin.append(reinterpret_cast<const char*>(&header), sizeof(header));
+				values[0] = power;
+				for (int i = 0; i < n; i++) {
+					values[1 + i] = spectrum[i];
+				}
+				bin.append(reinterpret_cast<const char*>(&values[0]),
+						values.size()*sizeof(float));
+			}
+		}
+
+		if (_opt.csv) {
+			_result = csv.str();
+		} else {
+			_result.swap(bin);
+		}
+	}
+
+	/// @return The formatted results
+	const std::string& result() const { return _result; }
+
+protected:
+	const Options& _opt;
+	const Input& _in;
+	int _chan;
+	int _gate0;
+	int _gate1;
+	long long _block;
+	std::string _result;
+};
+
+//////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv) {
+
+	Options opt;
+	if (!parseArgs(argc, argv, opt)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	// map the input file
+	int fd = open(opt.input.c_str(), O_RDONLY);
+	if (fd < 0) {
+		perror(opt.input.c_str());
+		return 1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		perror(opt.input.c_str());
+		return 1;
+	}
+
+	Input in;
+	in.length = st.st_size;
+	in.sampleBytes = opt.isFloat ? sizeof(float) : sizeof(short);
+	in.pulseBytes = (size_t)opt.gates * 2 * in.sampleBytes;
+	in.pulses = in.length / (in.pulseBytes * opt.channels);
+
+	long long nBlocks = in.pulses / opt.blockSize;
+	if (nBlocks == 0) {
+		std::cerr << opt.input << ": fewer than " << opt.blockSize <<
+			" pulses per channel" << std::endl;
+		return 1;
+	}
+
+	void* map = mmap(0, in.length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	madvise(map, in.length, MADV_SEQUENTIAL);
+	in.data = static_cast<const char*>(map);
+
+	std::ofstream out(opt.output.c_str(), std::ios::out | std::ios::binary);
+	if (!out) {
+		std::cerr << "unable to open " << opt.output << std::endl;
+		return 1;
+	}
+
+	if (opt.csv && opt.sampleRateHz > 0.0) {
+		// frequencies of the spectral points, matching the
+		// zero-centered ordering of SpectrumCalc::powerSpectrum()
+		out << "# frequency_Hz,,,";
+		for (int i = 0; i < opt.blockSize; i++) {
+			out << "," << (i - opt.blockSize/2) * opt.sampleRateHz / opt.blockSize;
+		}
+		out << "\n";
+	}
+
+	QThreadPool pool;
+	if (opt.threads > 0) {
+		pool.setMaxThreadCount(opt.threads);
+	}
+
+	// Time blocks are processed in batches, large enough to keep all of
+	// the threads busy, small enough to bound the memory used for results.
+	int nGateTasks = (opt.gateStop - opt.gateStart + opt.gatesPerTask) / opt.gatesPerTask;
+	int tasksPerBlock = nGateTasks * opt.channels;
+	long long blocksPerBatch = (4 * pool.maxThreadCount() + tasksPerBlock - 1) / tasksPerBlock;
+
+	for (long long b0 = 0; b0 < nBlocks; b0 += blocksPerBatch) {
+		long long b1 = std::min(b0 + blocksPerBatch, nBlocks);
+
+		std::vector<Task*> tasks;
+		for (long long b = b0; b < b1; b++) {
+			for (int c = 0; c < opt.channels; c++) {
+				for (int g0 = opt.gateStart; g0 <= opt.gateStop; g0 += opt.gatesPerTask) {
+					int g1 = std::min(g0 + opt.gatesPerTask - 1, opt.gateStop);
+					Task* t = new Task(opt, in, c, g0, g1, b);
+					tasks.push_back(t);
+					pool.start(t);
+				}
+			}
+		}
+		pool.waitForDone();
+
+		for (unsigned int i = 0; i < tasks.size(); i++) {
+			out.write(tasks[i]->result().data(), tasks[i]->result().size());
+			delete tasks[i];
+		}
+		if (!out) {
+			std::cerr << "error writing " << opt.output << std::endl;
+			return 1;
+		}
+	}
+
+	munmap(map, in.length);
+	close(fd);
+
+	std::cerr << "processed " << nBlocks << " blocks of " << opt.blockSize <<
+		" pulses, " << opt.channels << " channel(s), gates " << opt.gateStart <<
+		"-" << opt.gateStop << std::endl;
+
+	return 0;
+}
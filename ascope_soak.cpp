@@ -0,0 +1,667 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ascope_soak: end to end throughput soak test for AScopeEngine.
+//
+// A synthetic producer, running in its own thread, generates
+// ShortTimeSeries or FloatTimeSeries items at a given PRF, gate count
+// and channel count, and delivers them to AScopeEngine::newTSItemSlot()
+// through a queued signal, just as a real data source would. Items come
+// from a fixed pool of buffers, which are only reused after the engine
+// hands them back with returnTSItem(). If no buffer is free when an item
+// is due, the item is counted as dropped. With --batch, the items are
+// grouped and sent to newTSBatchSlot() instead, and come back a batch
+// at a time with returnTSBatch().
+//
+// A number of subscribers ask the engine for frames at a display rate,
+// so the gather, fft and delivery paths are exercised as well.
+//
+// Once a second, and at the end, it reports:
+//   items/s     items returned by the engine per second
+//   drops       items that could not be sent because the pool was empty
+//   inflight    items sent and not yet returned (the queue depth)
+//   frames/s    frames delivered to the subscribers per second
+//   rss         resident memory, and its growth since the start
+//   latency     time from sending an item to its return: p50, p99,
+//               p99.9 and max, over the reporting interval (from a
+//               bounded sample); the summary gives them over the whole
+//               run, from a fixed size histogram
+//
+// The run fails (exit status 2) if any items were dropped.
+
+#include "AScopeEngine.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QTimer>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+
+/// Command line options
+struct Options {
+	Options():
+		prf(10000.0),
+		gates(1000),
+		channels(1),
+		pulsesPerItem(32),
+		batch(1),
+		isFloat(false),
+		duration(30.0),
+		poolSize(64),
+		subscribers(1),
+		blockSize(256),
+		spectrum(true),
+		displayHz(25.0),
+		config(AScopeEngine::WorkerConfig::fromEnvironment())
+		{}
+	double prf;
+	int gates;
+	int channels;
+	int pulsesPerItem;
+	int batch;
+	bool isFloat;
+	double duration;
+	int poolSize;
+	int subscribers;
+	int blockSize;
+	bool spectrum;
+	double displayHz;
+	AScopeEngine::WorkerConfig config;
+};
+
+//////////////////////////////////////////////////////////////////////
+/// @return A monotonic time, in seconds.
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1.0e-9*ts.tv_nsec;
+}
+
+//////////////////////////////////////////////////////////////////////
+/// @return The resident set size of this process, in kB.
+static long rssKb() {
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line)) {
+		if (line.compare(0, 6, "VmRSS:") == 0) {
+			return atol(line.c_str() + 6);
+		}
+	}
+	return 0;
+}
+
+/// One buffer from the producer's pool, carried in TimeSeries::handle.
+struct Buffer {
+	/// The I,Q data for all pulses, gates interleaved as in IQbeams
+	std::vector<char> data;
+	/// When the item was sent
+	double sentAt;
+};
+
+/// Latencies counted in logarithmic buckets, 20 to a decade from
+/// 1 us to 1000 s, so that the memory is fixed however long the run
+/// is. Percentiles are good to about 6%; the maximum is exact.
+struct LatencyHistogram {
+	enum { PER_DECADE = 20, DECADES = 9, BUCKETS = PER_DECADE*DECADES + 2 };
+	LatencyHistogram(): counts(BUCKETS, 0), total(0), max(0.0) {}
+	/// Count a latency, in seconds.
+	void add(double secs) {
+		int b = 0;
+		if (secs > 1.0e-6) {
+			b = 1 + (int)(log10(secs/1.0e-6)*PER_DECADE);
+			if (b >= BUCKETS) {
+				b = BUCKETS - 1;
+			}
+		}
+		counts[b]++;
+		total++;
+		if (secs > max) {
+			max = secs;
+		}
+	}
+	/// Add the counts of another histogram.
+	void merge(const LatencyHistogram& other) {
+		for (int b = 0; b < BUCKETS; b++) {
+			counts[b] += other.counts[b];
+		}
+		total += other.total;
+		if (other.max > max) {
+			max = other.max;
+		}
+	}
+	/// @return A percentile, in seconds, or 0 if nothing was counted.
+	/// @param p The percentile, as a fraction.
+	double percentile(double p) const {
+		if (total == 0) {
+			return 0.0;
+		}
+		long long rank = (long long)(p*(total - 1) + 0.5);
+		long long n = 0;
+		int b = 0;
+		for (; b < BUCKETS - 1; b++) {
+			n += counts[b];
+			if (n > rank) {
+				break;
+			}
+		}
+		// the geometric middle of the bucket, but never above the maximum
+		double secs = (b == 0) ? 1.0e-6 : 1.0e-6*pow(10.0, (b - 0.5)/PER_DECADE);
+		return secs < max ? secs : max;
+	}
+	std::vector<long long> counts;
+	long long total;
+	double max;
+};
+
+/// The latencies of one reporting interval. At most CAPACITY values
+/// are kept; after that each new value replaces a random one
+/// (reservoir sampling), so that the percentiles stay representative
+/// at any rate. The maximum is exact.
+struct LatencySample {
+	enum { CAPACITY = 65536 };
+	LatencySample(): seen(0), max(0.0), rng(88172645463325252ULL) {}
+	/// Add a latency, in seconds.
+	void add(double secs) {
+		seen++;
+		if (values.size() < CAPACITY) {
+			values.push_back(secs);
+		} else {
+			// xorshift, which is plenty for choosing a slot
+			rng ^= rng << 13;
+			rng ^= rng >> 7;
+			rng ^= rng << 17;
+			unsigned long long i = rng % seen;
+			if (i < CAPACITY) {
+				values[i] = secs;
+			}
+		}
+		if (secs > max) {
+			max = secs;
+		}
+	}
+	/// @return A percentile, in seconds, or 0 if there are no values.
+	/// Sorts the values.
+	/// @param p The percentile, as a fraction.
+	double percentile(double p) {
+		if (values.empty()) {
+			return 0.0;
+		}
+		if (p >= 1.0) {
+			return max;
+		}
+		std::sort(values.begin(), values.end());
+		size_t i = (size_t)(p * (values.size() - 1) + 0.5);
+		return values[i];
+	}
+	std::vector<double> values;
+	long long seen;
+	double max;
+	unsigned long long rng;
+};
+
+/// Statistics accumulated by the producer over a reporting interval
+struct Stats {
+	Stats(): sent(0), returned(0), dropped(0), inflight(0) {}
+	long long sent;
+	long long returned;
+	long long dropped;
+	int inflight;
+	/// The latencies of the returned items, in seconds
+	LatencySample latencies;
+	/// All of the latencies, for the run totals
+	LatencyHistogram histogram;
+};
+
+/**
+ SoakProducer generates time series items at the configured rate.
+ It lives in its own thread; it is paced by a fast timer, and on each
+ tick sends as many items as are due, so the average rate is held
+ even if ticks are late.
+ **/
+class SoakProducer : public QObject {
+	Q_OBJECT
+public:
+	SoakProducer(const Options& opt):
+		_opt(opt),
+		_sent(0),
+		_start(0.0),
+		_timer(0)
+	{
+		int sampleBytes = opt.isFloat ? sizeof(float) : sizeof(short);
+		size_t beamBytes = (size_t)opt.gates * 2 * sampleBytes;
+
+		// Fill the buffers once, with a tone in noise, so that the
+		// cost of making data does not count against the engine.
+		_pool.resize(opt.poolSize);
+		for (int b = 0; b < opt.poolSize; b++) {
+			Buffer& buf = _pool[b];
+			buf.data.resize(beamBytes * opt.pulsesPerItem);
+			for (int p = 0; p < opt.pulsesPerItem; p++) {
+				for (int g = 0; g < opt.gates; g++) {
+					double phase = 0.3 * (b * opt.pulsesPerItem + p);
+					double i = 1000.0*cos(phase) + (rand() % 200 - 100);
+					double q = 1000.0*sin(phase) + (rand() % 200 - 100);
+					size_t off = p * beamBytes + (size_t)g * 2 * sampleBytes;
+					if (opt.isFloat) {
+						float* f = reinterpret_cast<float*>(&buf.data[off]);
+						f[0] = i;
+						f[1] = q;
+					} else {
+						short* s = reinterpret_cast<short*>(&buf.data[off]);
+						s[0] = (short)i;
+						s[1] = (short)q;
+					}
+				}
+			}
+			_free.push_back(&buf);
+		}
+	}
+
+	/// @return The statistics since the last call, and reset them.
+	Stats takeStats() {
+		QMutexLocker locker(&_mutex);
+		Stats s = _stats;
+		s.inflight = _opt.poolSize - _free.size();
+		_stats = Stats();
+		return s;
+	}
+
+signals:
+	/// Connected to AScopeEngine::newTSItemSlot()
+	void newTSItem(AScope::TimeSeries pItem);
+	/// Connected to AScopeEngine::newTSBatchSlot()
+	void newTSBatch(AScope::TimeSeriesBatch batch);
+
+public slots:
+	/// Start producing. Invoked in the producer thread.
+	void startSlot() {
+		_start = now();
+		_sent = 0;
+		_timer = new QTimer(this);
+		connect(_timer, SIGNAL(timeout()), this, SLOT(tickSlot()));
+		_timer->start(1);
+	}
+
+	/// Stop producing.
+	void stopSlot() {
+		if (_timer) {
+			_timer->stop();
+		}
+	}
+
+	/// Send the items that are due.
+	void tickSlot() {
+		double itemRate = _opt.prf * _opt.channels / _opt.pulsesPerItem;
+		long long due = (long long)((now() - _start) * itemRate);
+		int sampleBytes = _opt.isFloat ? sizeof(float) : sizeof(short);
+		size_t beamBytes = (size_t)_opt.gates * 2 * sampleBytes;
+		AScope::TimeSeriesBatch batch;
+
+		while (_sent < due) {
+			Buffer* buf;
+			{
+				QMutexLocker locker(&_mutex);
+				if (_free.empty()) {
+					_stats.dropped++;
+					_sent++;
+					continue;
+				}
+				buf = _free.back();
+				_free.pop_back();
+				_stats.sent++;
+			}
+
+			AScope::TimeSeries item(_opt.isFloat ?
+					AScope::TimeSeries::FLOATDATA : AScope::TimeSeries::SHORTDATA);
+			item.gates = _opt.gates;
+			item.chanId = _sent % _opt.channels;
+			item.sampleRateHz = _opt.prf;
+			item.handle = buf;
+			item.IQbeams.resize(_opt.pulsesPerItem);
+			for (int p = 0; p < _opt.pulsesPerItem; p++) {
+				item.IQbeams[p] = &buf->data[p * beamBytes];
+			}
+			buf->sentAt = now();
+			_sent++;
+			if (_opt.batch <= 1) {
+				emit newTSItem(item);
+				continue;
+			}
+			batch.append(item);
+			if (batch.size() >= _opt.batch) {
+				emit newTSBatch(batch);
+				batch = AScope::TimeSeriesBatch();
+			}
+		}
+		// don't hold back the items that are due
+		if (batch.size() > 0) {
+			emit newTSBatch(batch);
+		}
+	}
+
+	/// Recycle a buffer returned by the engine.
+	void returnTSItemSlot(AScope::TimeSeries pItem) {
+		Buffer* buf = static_cast<Buffer*>(pItem.handle);
+		double latency = now() - buf->sentAt;
+		QMutexLocker locker(&_mutex);
+		_stats.returned++;
+		_stats.latencies.add(latency);
+		_stats.histogram.add(latency);
+		_free.push_back(buf);
+	}
+
+	/// Recycle the buffers of a returned batch.
+	void returnTSBatchSlot(AScope::TimeSeriesBatch batch) {
+		for (int i = 0; i < batch.size(); i++) {
+			returnTSItemSlot(batch[i]);
+		}
+	}
+
+protected:
+	Options _opt;
+	/// The buffer pool
+	std::vector<Buffer> _pool;
+	/// The buffers available for sending
+	std::vector<Buffer*> _free;
+	/// Items sent or dropped since the start
+	long long _sent;
+	/// When production started
+	double _start;
+	/// The pacing timer
+	QTimer* _timer;
+	/// Protects _free and _stats
+	QMutex _mutex;
+	/// The statistics for the current interval
+	Stats _stats;
+};
+
+/**
+ SoakMonitor plays the part of the views: it subscribes to the engine,
+ requests frames at the display rate, counts them, and prints the
+ report once a second.
+ **/
+class SoakMonitor : public QObject {
+	Q_OBJECT
+public:
+	SoakMonitor(const Options& opt, AScopeEngine& engine, SoakProducer& producer):
+		_opt(opt),
+		_engine(engine),
+		_producer(producer),
+		_frames(0),
+		_startRss(rssKb()),
+		_start(now()),
+		_last(_start)
+	{
+		// spread the subscribers over the channels and gates
+		for (int i = 0; i < opt.subscribers; i++) {
+			AScopeEngine::Selection sel;
+			sel.channel = i % opt.channels;
+			sel.gate = (i * 37) % opt.gates;
+			sel.blockSize = opt.blockSize;
+			sel.spectrum = opt.spectrum;
+			_ids.push_back(_engine.subscribe(sel));
+		}
+		connect(&_engine, SIGNAL(frameReady(int, ScopeFramePtr)),
+				this, SLOT(frameSlot(int, ScopeFramePtr)));
+		connect(&_requestTimer, SIGNAL(timeout()), this, SLOT(requestSlot()));
+		connect(&_reportTimer, SIGNAL(timeout()), this, SLOT(reportSlot()));
+		_requestTimer.start((int)(1000.0/opt.displayHz));
+		_reportTimer.start(1000);
+
+		std::cout << "   time    items/s   drops inflight  frames/s    rss(MB)  growth(MB)"
+				"   p50(ms)   p99(ms) p99.9(ms)   max(ms)" << std::endl;
+	}
+
+	/// @return The items dropped over the whole run.
+	long long totalDropped() const { return _total.dropped; }
+
+	/// Print the summary for the whole run.
+	void summary() {
+		double elapsed = now() - _start;
+		std::cout << "\nsummary over " << std::fixed << std::setprecision(1)
+				<< elapsed << " s:\n"
+				<< "  items sent " << _total.sent << ", returned " << _total.returned
+				<< ", dropped " << _total.dropped << "\n"
+				<< "  sustained " << std::setprecision(0) << _total.returned/elapsed
+				<< " items/s, " << _total.returned*_opt.pulsesPerItem/elapsed/_opt.channels
+				<< " pulses/s per channel\n"
+				<< "  rss growth " << std::setprecision(1)
+				<< (rssKb() - _startRss)/1024.0 << " MB\n"
+				<< "  latency ms: p50 " << std::setprecision(3) << _allLatencies.percentile(0.5)*1e3
+				<< " p99 " << _allLatencies.percentile(0.99)*1e3
+				<< " p99.9 " << _allLatencies.percentile(0.999)*1e3
+				<< " max " << _allLatencies.percentile(1.0)*1e3 << std::endl;
+	}
+
+public slots:
+	void frameSlot(int, ScopeFramePtr) {
+		_frames++;
+	}
+
+	void requestSlot() {
+		for (unsigned int i = 0; i < _ids.size(); i++) {
+			_engine.requestFrame(_ids[i]);
+		}
+	}
+
+	void reportSlot() {
+		double t = now();
+		double interval = t - _last;
+		_last = t;
+
+		Stats s = _producer.takeStats();
+		_total.sent += s.sent;
+		_total.returned += s.returned;
+		_total.dropped += s.dropped;
+		_allLatencies.merge(s.histogram);
+
+		long rss = rssKb();
+		std::cout << std::fixed << std::setprecision(1)
+				<< std::setw(7) << t - _start
+				<< std::setprecision(0)
+				<< std::setw(11) << s.returned/interval
+				<< std::setw(8) << s.dropped
+				<< std::setw(9) << s.inflight
+				<< std::setw(10) << _frames/interval
+				<< std::setprecision(1)
+				<< std::setw(11) << rss/1024.0
+				<< std::setw(12) << (rss - _startRss)/1024.0
+				<< std::setprecision(3)
+				<< std::setw(10) << s.latencies.percentile(0.5)*1e3
+				<< std::setw(10) << s.latencies.percentile(0.99)*1e3
+				<< std::setw(10) << s.latencies.percentile(0.999)*1e3
+				<< std::setw(10) << s.latencies.percentile(1.0)*1e3
+				<< std::endl;
+		_frames = 0;
+	}
+
+protected:
+	Options _opt;
+	AScopeEngine& _engine;
+	SoakProducer& _producer;
+	std::vector<int> _ids;
+	QTimer _requestTimer;
+	QTimer _reportTimer;
+	long long _frames;
+	long _startRss;
+	double _start;
+	double _last;
+	Stats _total;
+	/// The latencies over the whole run
+	LatencyHistogram _allLatencies;
+};
+
+//////////////////////////////////////////////////////////////////////
+static void usage(const char* prog) {
+	std::cerr <<
+	"usage: " << prog << " [options]\n"
+	"  -p, --prf HZ          pulse rate per channel (10000)\n"
+	"  -g, --gates N         gates per pulse (1000)\n"
+	"  -c, --channels N      number of channels (1)\n"
+	"  -n, --pulses N        pulses per item (32)\n"
+	"  -B, --batch N         items per newTSBatchSlot() call; 1 sends\n"
+	"                        each item to newTSItemSlot() (1)\n"
+	"  -t, --type T          sample type: short or float (short)\n"
+	"  -d, --duration S      run time in seconds (30)\n"
+	"  -P, --pool N          item buffers in the pool (64)\n"
+	"  -s, --subscribers N   number of subscribers (1)\n"
+	"  -b, --block N         subscriber block size (256)\n"
+	"  -T, --time-series     subscribers do not ask for the spectrum\n"
+	"  -r, --display HZ      subscriber frame request rate (25)\n"
+	"  -j, --workers N       engine worker threads (ASCOPE_WORKERS, or 0)\n";
+}
+
+//////////////////////////////////////////////////////////////////////
+static bool parseArgs(int argc, char** argv, Options& opt) {
+	static struct option longOpts[] = {
+		{"prf",         required_argument, 0, 'p'},
+		{"gates",       required_argument, 0, 'g'},
+		{"channels",    required_argument, 0, 'c'},
+		{"pulses",      required_argument, 0, 'n'},
+		{"batch",       required_argument, 0, 'B'},
+		{"type",        required_argument, 0, 't'},
+		{"duration",    required_argument, 0, 'd'},
+		{"pool",        required_argument, 0, 'P'},
+		{"subscribers", required_argument, 0, 's'},
+		{"block",       required_argument, 0, 'b'},
+		{"time-series", no_argument,       0, 'T'},
+		{"display",     required_argument, 0, 'r'},
+		{"workers",     required_argument, 0, 'j'},
+		{"help",        no_argument,       0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long(argc, argv, "p:g:c:n:B:t:d:P:s:b:Tr:j:h", longOpts, 0)) != -1) {
+		switch (c) {
+		case 'p': opt.prf = atof(optarg); break;
+		case 'g': opt.gates = atoi(optarg); break;
+		case 'c': opt.channels = atoi(optarg); break;
+		case 'n': opt.pulsesPerItem = atoi(optarg); break;
+		case 'B': opt.batch = atoi(optarg); break;
+		case 't':
+			if (!strcmp(optarg, "float")) {
+				opt.isFloat = true;
+			} else if (!strcmp(optarg, "short")) {
+				opt.isFloat = false;
+			} else {
+				std::cerr << "unknown sample type " << optarg << std::endl;
+				return false;
+			}
+			break;
+		case 'd': opt.duration = atof(optarg); break;
+		case 'P': opt.poolSize = atoi(optarg); break;
+		case 's': opt.subscribers = atoi(optarg); break;
+		case 'b': opt.blockSize = atoi(optarg); break;
+		case 'T': opt.spectrum = false; break;
+		case 'r': opt.displayHz = atof(optarg); break;
+		case 'j': opt.config.workers = atoi(optarg); break;
+		default:
+			return false;
+		}
+	}
+
+	if (optind != argc) {
+		return false;
+	}
+	if (opt.prf <= 0 || opt.gates <= 0 || opt.channels <= 0 || opt.pulsesPerItem <= 0 || opt.batch <= 0 ||
+			opt.poolSize <= 0 || opt.duration <= 0 || opt.displayHz <= 0 ||
+			opt.subscribers < 0 || opt.config.workers < 0) {
+		std::cerr << "rates, counts and sizes must be positive" << std::endl;
+		return false;
+	}
+	if (opt.blockSize < 2 || (opt.blockSize & (opt.blockSize-1))) {
+		std::cerr << "block size must be a power of two" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv) {
+
+	Options opt;
+	if (!parseArgs(argc, argv, opt)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	QCoreApplication app(argc, argv);
+
+	AScopeEngine engine(0, opt.config);
+
+	// the producer runs in its own thread, so that all of the
+	// traffic with the engine goes through queued connections
+	SoakProducer producer(opt);
+	QThread producerThread;
+	producer.moveToThread(&producerThread);
+	QObject::connect(&producer, SIGNAL(newTSItem(AScope::TimeSeries)),
+			&engine, SLOT(newTSItemSlot(AScope::TimeSeries)));
+	QObject::connect(&engine, SIGNAL(returnTSItem(AScope::TimeSeries)),
+			&producer, SLOT(returnTSItemSlot(AScope::TimeSeries)));
+	QObject::connect(&producer, SIGNAL(newTSBatch(AScope::TimeSeriesBatch)),
+			&engine, SLOT(newTSBatchSlot(AScope::TimeSeriesBatch)));
+	QObject::connect(&engine, SIGNAL(returnTSBatch(AScope::TimeSeriesBatch)),
+			&producer, SLOT(returnTSBatchSlot(AScope::TimeSeriesBatch)));
+
+	SoakMonitor monitor(opt, engine, producer);
+
+	std::cout << "ascope_soak: " << opt.prf << " Hz PRF, " << opt.gates << " gates, "
+			<< opt.channels << " channels, " << opt.pulsesPerItem << " pulses per item, "
+			<< opt.batch << " items per batch, "
+			<< (opt.isFloat ? "float" : "short") << " samples, "
+			<< opt.config.workers << " engine workers" << std::endl;
+
+	producerThread.start();
+	QMetaObject::invokeMethod(&producer, "startSlot", Qt::QueuedConnection);
+
+	// stop producing at the end of the run, then give the
+	// engine a moment to hand back what is in flight
+	QTimer::singleShot((int)(opt.duration*1000), &producer, SLOT(stopSlot()));
+	QTimer::singleShot((int)(opt.duration*1000) + 1000, &app, SLOT(quit()));
+	app.exec();
+
+	monitor.reportSlot();
+	monitor.summary();
+
+	producerThread.quit();
+	producerThread.wait();
+
+	return monitor.totalDropped() ? 2 : 0;
+}
+
+#include "ascope_soak.moc"
@@ -18,26 +18,77 @@ env.Uic4(['AScope.ui',])
 
 sources = Split("""
 AScope.cpp
+AScopeEngine.cpp
+Cfar.cpp
+DspKernels.cpp
+FrameHistory.cpp
+FramePublisher.cpp
+GateRing.cpp
+GateStats.cpp
+GateWindow.cpp
+ImageWriter.cpp
+LatencyStats.cpp
 PlotInfo.cpp
+PreFilter.cpp
+RtiPlot.cpp
+ShmFrameRing.cpp
+ShmRing.cpp
+ShmRingReader.cpp
+SpectrumCalc.cpp
+Trigger.cpp
 """) 
 
 headers = Split("""
 AScope.h
+AScopeEngine.h
+Cfar.h
+DspKernels.h
+FrameHistory.h
+FramePublisher.h
+GateRing.h
+GateStats.h
+GateWindow.h
+ImageWriter.h
+LatencyStats.h
 PlotInfo.h
+PreFilter.h
+RtiPlot.h
+ScopeFrame.h
+ShmFrameRing.h
+ShmRing.h
+ShmRingReader.h
+SpectrumCalc.h
+Trigger.h
 """)
 
 env['DOXYFILE_DICT'].update({'PROJECT_NAME':'Ascope'})
 html = env.Apidocs(sources + headers)
 
-ascope = env.Library('ascope', sources)
+# The instruction set variants of the DSP kernels rely on the
+# vectorizer, which older compilers only run at -O3.
+kernels = env.Object('DspKernels.cpp',
+                     CXXFLAGS = env.get('CXXFLAGS', []) + ['-O3'])
 
-Default(ascope)
+ascope = env.Library('ascope',
+                     [s for s in sources if s != 'DspKernels.cpp'] + kernels)
+
+# Headless batch processing of recorded time series, using the
+# same numerics as the scope.
+batch = env.Program('ascope_batch', ['ascope_batch.cpp', 'SpectrumCalc.cpp'] + kernels)
+
+# Throughput soak test of the engine, with a synthetic producer.
+soak = env.Program('ascope_soak', ['ascope_soak.cpp', ascope],
+                   LIBS = env.get('LIBS', []) + ['rt'])
+
+Default(ascope, batch, soak)
 
 tooldir = env.Dir('.').srcnode().abspath    # this directory
 
 def ascope(env):
     env.AppendUnique(CPPPATH = [tooldir])
     env.AppendLibrary('ascope')
+    # shm_open() for the shared memory ring
+    env.AppendUnique(LIBS = ['rt'])
     env.AppendDoxref('ascope')
     env.Require(tools)
 